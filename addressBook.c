@@ -5,11 +5,27 @@ Description: This C program implements an address book application in C that use
 to manage a list of contacts.
 */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define X86_FILTER_KERNELS
+#endif
 
 enum MenuOption 
 {
@@ -24,7 +40,25 @@ enum MenuOption
     LOAD_CONTACTS_OPTION,
     APPEND_FILE_OPTION,
     MERGE_FILE_OPTION,
-    EXIT_OPTION
+    EXIT_OPTION,
+    SORT_CONTACTS_OPTION,
+    LOAD_MAPPED_OPTION,
+    SAVE_SNAPSHOT_OPTION,
+    LOAD_SNAPSHOT_OPTION,
+    OPEN_JOURNAL_OPTION,
+    COMPACT_JOURNAL_OPTION,
+    STATISTICS_OPTION,
+    FIND_PHONE_OPTION,
+    REMOVE_PHONE_OPTION,
+    EDIT_PHONE_OPTION,
+    SEARCH_PREFIX_OPTION,
+    FUZZY_SEARCH_OPTION,
+    MERGE_FILES_OPTION,
+    LIST_PAGE_OPTION,
+    LOAD_LAZY_OPTION,
+    FILTER_OPTION,
+    AGGREGATE_OPTION,
+    REMOVE_WHERE_OPTION
 };
 
 enum EditOption 
@@ -37,1133 +71,7976 @@ enum EditOption
     CANCEL
 };
 
+enum SortKey
+{
+    SORT_BY_NAME = 1,
+    SORT_BY_AGE,
+    SORT_BY_PHONE,
+    SORT_BY_ADDRESS
+};
+
+enum SortOrder
+{
+    SORT_ASCENDING = 1,
+    SORT_DESCENDING
+};
+
+/*
+Room for short strings inside the Contact itself, sized so a Contact fills one 64 byte
+cache line. Names and addresses are packed into it in that order while they fit.
+*/
+#define CONTACT_TEXT_SIZE 27
+
 typedef struct Contact {
     char* firstName;
     char* familyName;
     long long phonNum; /* 10-digit phone number stored as a 64-bit integer */
     char* address;
     int age;
+    unsigned char flags; /* ContactOwnership bits for the parts allocated on the heap */
+    char text[CONTACT_TEXT_SIZE]; /* short strings the pointers above may point into */
 } Contact;
 
-void printMenuOptions();
+/*
+Contacts read interactively are allocated on the heap, as is any string of theirs too
+long for text. Contacts loaded from a file are carved from the book's arena, strings
+included, and own nothing until editContact replaces a string. Strings kept in text
+are never owned.
+*/
+enum ContactOwnership
+{
+    OWNS_FIRST_NAME = 1,
+    OWNS_FAMILY_NAME = 2,
+    OWNS_ADDRESS = 4,
+    OWNS_CONTACT = 8,
+    OWNS_ALL = 15
+};
+
+/*
+Slab allocator for bulk loaded contacts and their strings. Slabs grow geometrically
+and are only ever released all together by freeArena().
+*/
+typedef struct ArenaSlab {
+    struct ArenaSlab* next;
+    size_t used;
+    size_t size;
+    char data[];
+} ArenaSlab;
+
+typedef struct Arena {
+    ArenaSlab* slabs; /* most recent slab first */
+    size_t nextSlabSize;
+    bool threadOwned; /* filled by a loader thread, which counts in blockCount and slabCount
+                         until adoptArena hands the slabs and counts over */
+    unsigned long long blockCount;
+    unsigned long long slabCount;
+} Arena;
+
+typedef struct ArenaMark {
+    ArenaSlab* slab;
+    size_t used;
+} ArenaMark;
 
-int countContacts(Contact **contacts);
+/*
+A contact paired with an integer prefix of its sort key, see mergeSortContacts.
+*/
+typedef struct SortEntry {
+    unsigned long long prefix;
+    Contact* contact;
+} SortEntry;
 
-bool validPhoneNumber(char buffer[]);
+/*
+Open-addressing (linear probing) hash index from full name to contact. The stored
+hash lets most probes skip the strcmp. A name may be present more than once since
+appendContact does not reject duplicates.
+*/
+typedef struct NameIndexSlot {
+    unsigned int hash;
+    int position; /* slot of contact in the book when last seen, see findContactPosition */
+    Contact* contact; /* NULL for an empty slot */
+} NameIndexSlot;
+
+typedef struct NameIndex {
+    NameIndexSlot* slots;
+    size_t capacity; /* always a power of two */
+    size_t count;
+} NameIndex;
 
-bool validAge(char buffer[]);
+/*
+Open addressing hash of contacts by phone number, the same layout as NameIndex.
+Several contacts may share a number, each has its own slot.
+*/
+typedef struct PhoneIndexSlot {
+    long long phonNum;
+    Contact* contact; /* NULL for an empty slot */
+} PhoneIndexSlot;
 
-Contact *readNewContact();
+typedef struct PhoneIndex {
+    PhoneIndexSlot* slots;
+    size_t capacity; /* always a power of two */
+    size_t count;
+} PhoneIndex;
 
-Contact **appendContact(Contact **contacts, Contact *newContact);
+/*
+Contact positions sorted case-insensitively by family name and by first name, so
+the contacts starting with a prefix form one run found by binary search. key holds
+the first 16 lowercased bytes of the name for cheap comparisons while sorting.
+*/
+typedef struct PrefixEntry {
+    unsigned long long key;
+    unsigned long long keyRest;
+    int position;
+} PrefixEntry;
+
+typedef struct PrefixIndex {
+    PrefixEntry* byFamilyName;
+    PrefixEntry* byFirstName;
+    int count;
+    unsigned long builtVersion; /* book version the entries were built for */
+} PrefixIndex;
 
-Contact** insertContactAlphabetical(Contact** contacts, Contact* newContact);
+/*
+Trigrams of the lowercased first and family names, each word padded with two spaces
+on both sides, hashed into buckets. Bucket b lists the positions of the contacts
+with a trigram in it in positions[bucketStarts[b] .. bucketStarts[b + 1]).
+*/
+#define TRIGRAM_BUCKET_BITS 18
+#define TRIGRAM_BUCKETS (1 << TRIGRAM_BUCKET_BITS)
+#define MAX_TRIGRAMS 256
+
+typedef struct TrigramIndex {
+    int* bucketStarts;
+    int* positions;
+    unsigned int* seen; /* per contact, the last query that made it a candidate */
+    int* hits; /* per candidate contact, how many of the query's short lists hold it */
+    int* candidates;
+    unsigned int query;
+    int count;
+    unsigned long builtVersion;
+} TrigramIndex;
 
-void freeContact(Contact *c);
+/*
+Filtered and/or sorted copy of the contact pointers that listContactsPage pages
+through, kept until the book version, the filter or the order changes.
+*/
+typedef struct ListView {
+    Contact** contacts;
+    int count;
+    int key;   /* SortKey, 0 keeps book order */
+    int order;
+    char filter[100];
+    unsigned long builtVersion;
+} ListView;
 
-void freeAddressBook(Contact** addressBook);
+/*
+Contiguous copies of the fields the filter kernels scan, rebuilt from the contacts
+once the book version moves on. Row i of every column is book->contacts[i]; the
+phone and age columns are padded with zeros to a multiple of 64 rows so the kernels
+only ever work on whole selection words.
+*/
+typedef struct ContactColumns {
+    int64_t* phones;
+    uint8_t* ages;
+    const char** firstNames;
+    const char** familyNames;
+    int count;
+    unsigned long builtVersion;
+} ContactColumns;
 
-Contact** removeContactByIndex(Contact** contacts);
+/*
+Inclusive ranges a contact must fall in, see filterContacts.
+*/
+typedef struct ContactFilter {
+    int minAge;
+    int maxAge;
+    long long minPhone;
+    long long maxPhone;
+} ContactFilter;
 
-int removeContactByFullName(Contact** contacts);
+/*
+Age figures of a whole book, see summarizeAges. histogram[a] is the number of
+contacts aged a. Age 0 means the age is unknown (an invalid age in a loaded file), so
+those contacts are only counted in unknown and left out of the figures.
+*/
+typedef struct AgeSummary {
+    int count;
+    int unknown;
+    int minAge;
+    int maxAge;
+    double mean;
+    double median;
+    int histogram[256];
+} AgeSummary;
 
-void listContacts(Contact** contacts);
+/*
+One group of an aggregate, an area code or a family name, and its contact count.
+*/
+typedef struct GroupCount {
+    const char* name;
+    int code;
+    int count;
+} GroupCount;
 
-void saveContactsToFile(Contact** contacts, char* filename);
+/*
+Slot of the countFamilyNames hash table, group is -1 when the slot is empty.
+*/
+typedef struct FamilySlot {
+    unsigned int hash;
+    int group;
+} FamilySlot;
 
-void printContactsToFile(Contact** contacts, char* filename);
+/*
+A full name to remove, see selectNamedContacts.
+*/
+typedef struct NameKey {
+    unsigned int hash;
+    const char* firstName;
+    const char* familyName;
+} NameKey;
 
-Contact** loadContactsFromFile(Contact** addressBook, char* filename);
+typedef struct FuzzyMatch {
+    int position;
+    int distance;
+} FuzzyMatch;
 
-Contact** appendContactsFromFile(Contact** contacts, char* filename);
+/*
+Buffered reader over the text format written by saveContactsToFile. Lines are
+handed out as views into the read buffer and stay valid until the next read.
+*/
+typedef struct RecordReader {
+    FILE* stream;
+    char* buffer;
+    size_t size;
+    size_t start; /* first unread byte */
+    size_t end;   /* one past the last byte read */
+    bool eof;
+    char head[128]; /* start of a line longer than buffer, see readRecordLine */
+} RecordReader;
 
-void InsertionSort(Contact** contacts);
+/*
+Output side of RecordReader, used by save, print and list. Strings are copied into a
+large buffer with memcpy and integers formatted by hand; the buffer goes to the
+stream in one fwrite whenever it fills.
+*/
+typedef struct OutputWriter {
+    FILE* stream;
+    char* buffer;
+    size_t size;
+    size_t used;
+    bool failed; /* a write to the stream came up short */
+} OutputWriter;
 
-Contact **mergeContactsFromFile(Contact** contacts, char* filename);
+/*
+What a sink did with a record handed to it by readContactsFromFile.
+*/
+enum SinkResult
+{
+    SINK_ACCEPTED,
+    SINK_REJECTED, /* the record is dropped and its arena memory reclaimed */
+    SINK_FAILED    /* stop reading */
+};
 
-Contact** editContact(Contact** contacts);
+/*
+Counted, capacity-tracked container for the contacts. contacts[0..count) are valid,
+capacity is the number of slots allocated; the array grows geometrically.
+*/
+typedef struct AddressBook {
+    Contact** contacts;
+    int count;
+    int capacity;
+    Arena arena;
+    int ownedContacts; /* contacts with at least one heap allocated part */
+    NameIndex names;
+    bool namesDeferred; /* names is empty and gets built on first lookup */
+    int positionDrift; /* how far a contact may have moved since its position in names was set */
+    PhoneIndex phones;
+    bool phonesDeferred; /* phones is empty and gets built on the first phone lookup */
+    unsigned long version; /* changes whenever contacts are added, removed, edited or reordered */
+    PrefixIndex prefixes; /* rebuilt on the next search once version moves on */
+    TrigramIndex trigrams; /* rebuilt on the next fuzzy search once version moves on */
+    ListView view; /* rebuilt on the next listContactsPage once version moves on */
+    ContactColumns columns; /* rebuilt on the next filter once version moves on */
+    char* mapping; /* file mapped by loadMappedContacts or loadSnapshot, strings point into it */
+    size_t mappingSize;
+    bool lazyAddresses; /* loaded by loadMappedContacts, addresses in the mapping are unterminated lines */
+    int tombstones; /* NULL slots left in contacts by deferred removals, see settleRemovals */
+    int* liveSlots; /* Fenwick tree of the live slots, kept while tombstones > 0 */
+    FILE* journal; /* open while the book is backed by journalBase plus its journal */
+    char* journalBase;
+} AddressBook;
 
-int main()
+/*
+Operations with a call counter and latency histogram. PARSE_RECORD, NAME_IN_BOOK and
+SHIFT_CONTACTS split a slow load or merge into parsing, duplicate checks and array shifting.
+*/
+enum StatOperation
 {
+    STAT_APPEND_CONTACT,
+    STAT_INSERT_ALPHABETICAL,
+    STAT_NAME_IN_BOOK,
+    STAT_PARSE_RECORD,
+    STAT_SHIFT_CONTACTS,
+    STAT_LOAD_FILE,
+    STAT_LOAD_MAPPED,
+    STAT_LOAD_LAZY,
+    STAT_LOAD_SNAPSHOT,
+    STAT_APPEND_FILE,
+    STAT_MERGE_FILE,
+    STAT_MERGE_FILES,
+    STAT_SAVE_FILE,
+    STAT_PRINT_FILE,
+    STAT_SAVE_SNAPSHOT,
+    NUM_STAT_OPERATIONS
+};
 
-    int option = 0;
-    Contact** addressBook = NULL;
-    Contact** newAddressBook = NULL;
-    char filename[100] = {"\0"};
+/*
+Latencies are bucketed by power of two with four sub-buckets each, so a percentile
+read from the histogram is within 25% of the true value.
+*/
+#define STAT_BUCKETS 252
+
+typedef struct OperationStats {
+    unsigned long long calls;
+    unsigned long long totalNs;
+    unsigned long long maxNs;
+    unsigned long long buckets[STAT_BUCKETS];
+} OperationStats;
+
+typedef struct Statistics {
+    OperationStats operations[NUM_STAT_OPERATIONS];
+    unsigned long long heapAllocations;
+    unsigned long long arenaAllocations;
+    unsigned long long stringComparisons;
+    unsigned long long bytesRead;
+    unsigned long long bytesWritten;
+} Statistics;
 
-    /*
-    start by adding the NULL ending to the array
-    */
+/*
+Binary snapshot: a header, a table of fixed-width records and a heap of NUL-terminated
+strings the records point into. Every section starts on an 8-byte boundary so a mapping
+of the file can be used in place. Integers are stored in native byte order.
+*/
+#define SNAPSHOT_MAGIC "ABOOKSNP"
+#define SNAPSHOT_VERSION 1
+
+typedef struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t recordCount;
+    uint64_t recordTableOffset;
+    uint64_t stringHeapOffset;
+    uint64_t stringHeapSize;
+} SnapshotHeader;
+
+typedef struct SnapshotRecord {
+    int64_t phonNum;
+    uint64_t firstNameOffset; /* offsets are relative to the string heap */
+    uint64_t familyNameOffset;
+    uint64_t addressOffset;
+    uint32_t firstNameLength;
+    uint32_t familyNameLength;
+    uint32_t addressLength;
+    uint8_t age;
+    uint8_t reserved[3];
+} SnapshotRecord;
 
-    addressBook = (Contact**)malloc(sizeof(Contact*));
-    if (addressBook == NULL)
-    {
-        fprintf(stderr, "Could not allocate address book");
-        return 1;
-    }
-    addressBook[0] = NULL;
-    
-    while (option != EXIT_OPTION)
-    {
-        printMenuOptions();
-        scanf("%d", &option);
+/*
+Receives the records parsed by readContactsFromFile: begin() gets the record count
+from the file header, accept() each record in file order.
+*/
+typedef struct ContactSink {
+    bool (*begin)(AddressBook* book, int numContacts, void* context);
+    int (*accept)(AddressBook* book, Contact* c, void* context);
+    void* context;
+} ContactSink;
 
-        /* change to use case statements*/
-        switch(option)
-        {
-            case APPEND_CONTACT_OPTION:
-                printf("Adding a constact interactively: \n");
-                addressBook = appendContact(addressBook, readNewContact());
-                break;
-            case INSERT_ALPHA_OPTION:
-                printf("Inserting a contact in alphabetical order interactively: \n");
-                addressBook = insertContactAlphabetical(addressBook, readNewContact());
-                break;
-            case REMOVE_CONTACT_OPTION:
-                printf("Removing a Contact by index: \n");
-                addressBook = removeContactByIndex(addressBook);
-                break;
-            case REMOVE_CONTACT_NAME:
-                printf("Removing a Contact with a particular Name: \n");
-                removeContactByFullName(addressBook);
-                break;
-            case FIND_EDIT_CONTACT_OPTION:
-                addressBook = editContact(addressBook);
-                break;
-            case LIST_CONTACT_OPTION:
-                printf("\n");
-                listContacts(addressBook);
-                break;
-            case PRNT_FILE_OPTION:
-                printf("Enter filename to save: ");
-                scanf("%s", filename);
-                saveContactsToFile(addressBook, filename);
-                break;
-            case PRNT_FILE_HR_OPTION:
-                printf("Enter filename to print: ");
-                scanf("%s", filename);
-                printContactsToFile(addressBook, filename);
-                break;
-            case LOAD_CONTACTS_OPTION:
-                printf("Enter filename to load (replaces current contacts): ");
-                scanf("%s", filename);
-                addressBook = loadContactsFromFile(addressBook, filename);
-                break;
-            case APPEND_FILE_OPTION:
-                printf("Enter filename to append: ");
-                scanf("%s", filename);
-                addressBook = appendContactsFromFile(addressBook, filename);
-                break;
-            case MERGE_FILE_OPTION:
-                printf("Enter filename to merge: ");
-                scanf("%s", filename);
-                addressBook = mergeContactsFromFile(addressBook, filename);
-                break;
-            case EXIT_OPTION:
-                printf("Exiting program. Goodbye!");
-                freeAddressBook(addressBook);
-                break;
-        }
-        printf("\n");
-    }
-    return 0;
-}
+#define MAX_LOAD_THREADS 64
 
-void printMenuOptions()
-{
-    printf("Address Book Menu:\n1.  Append Contact\n2.  Insert Contact in Alphabetical Order\n3.  Remove Contact by Index\n");
-    printf("4.  Remove Contact by Full Name\n5.  Find and Edit Contact\n6.  List Contacts\n7.  Print Contacts to File with the format of an input file\n");
-    printf("8.  Print Contacts to File (Human Readable)\n9.  Load Contacts from File Replacing Existing Contacts\n10. Append Contacts from File\n");
-    printf("11. Merge Contacts from File\n12. Exit\n");
-    printf("Choose an option: ");
-}
+/*
+One slice of a mapped text file for readContactsParallel. begin and end sit on line
+starts; a record belongs to the chunk holding its first line and may run on past end.
+*/
+typedef struct LoadChunk {
+    const char* begin;
+    const char* end;
+    const char* fileEnd;
+    long long lines;     /* lines starting in [begin, end) */
+    long long firstLine; /* number of the line at begin, 0 being the first record's */
+    int firstRecord;
+    int skip;            /* lines before firstRecord starts */
+    int numRecords;
+    int parsed;
+    Contact** contacts;
+    Arena arena;
+    bool failed;
+} LoadChunk;
 
-int countContacts(Contact **contacts)
-{
-    int count = 0;
-    while (contacts[count] != NULL)
-    {
-        count += 1;
-    }
-    return count;
-}
+void printMenuOptions();
 
-bool validPhoneNumber(char buffer[])
-{
-    if (strlen(buffer) != 10 || buffer[0] == '0')
-    {
-        return false;
-    }
-    for (int i = 0; i < strlen(buffer); i++)
-    {
-        if (!isdigit(buffer[i]))
-        {
-            return false;
-        }
-    }
-    return true;
-}
+void report(const char* format, ...);
 
-bool validAge(char buffer[])
-{
-    int myAge = 0;
-    const int MAX_AGE = 150;
-    const int MIN_AGE = 1;
-    for (int i = 0; i < strlen(buffer); i++)
-    {
-        if (!isdigit(buffer[i]))
-        {
-            return false;
-        }
-    }
-    myAge = atoi(buffer);
-    if (!(myAge >= MIN_AGE && myAge <= MAX_AGE))
-    {
-        return false;
-    }
-    return true;
-}
+void* allocate(size_t size);
 
-Contact *readNewContact()
-{
-    char buffer[100] = {'\0'};
-    Contact* newContact = NULL;
-    char* myFirstName = NULL;
-    char* myFamilyName = NULL;
-    char* myAddress = NULL;
-    long long myPhoneNumber = 0;
-    int myAge = 0;
-    int attempts = 1;
-    const int MAX_ATTEMPTS = 5;
+void* allocateZeroed(size_t count, size_t size);
 
-    printf("Enter the first name: ");
-    fscanf(stdin, " %99[^\n]", buffer);
-    myFirstName = (char*)calloc(strlen(buffer) + 1, sizeof(char));
-    if (myFirstName == NULL)
-    {
-        fprintf(stderr, "Error: unable to allocate memory for the first name string");
-        return NULL;
-    }
-    strcpy(myFirstName, buffer);
+void* reallocate(void* pointer, size_t size);
 
-    printf("Enter the family name: ");
-    fscanf(stdin, " %99[^\n]", buffer);
-    myFamilyName = (char*)calloc(strlen(buffer) + 1, sizeof(char));
-    if (myFamilyName == NULL)
-    {
-        fprintf(stderr, "Error: unable to allocate memory for the family name string");
-        free(myFirstName);
-        return NULL;
-    }
-    strcpy(myFamilyName, buffer);
+unsigned long long statStart();
 
-    printf("Enter the address: ");
-    fscanf(stdin, " %99[^\n]", buffer);
-    myAddress = (char*)calloc(strlen(buffer) + 1, sizeof(char));
-    if (myAddress == NULL)
-    {
-        fprintf(stderr, "Error: unable to allocate memory for the address string");
-        free(myFirstName);
-        free(myFamilyName);
-        return NULL;
-    }
-    strcpy(myAddress, buffer);
+void statStop(int operation, unsigned long long start);
 
-    printf("Enter 10-digit phone number that must not start with 0: ");
-    fscanf(stdin, " %99[^\n]", buffer);
-    while (!validPhoneNumber(buffer) && attempts < MAX_ATTEMPTS)
-    {
-        printf("Error: Invalid phone number. Try again: ");
-        fscanf(stdin, " %99[^\n]", buffer);
-        attempts += 1;
-    }
-    if (!validPhoneNumber(buffer))
-    {
-        fprintf(stderr, "Error: Could not read a valid phone number\n");
-        myPhoneNumber = 0;
-    }
-    else
-    {
-        myPhoneNumber = atoll(buffer);
-    }
+unsigned long long statBucketLimit(int bucket);
 
-    attempts = 1;
+unsigned long long statPercentile(const OperationStats* operation, double fraction);
 
-    printf("Enter the age: ");
-    fscanf(stdin, " %99[^\n]", buffer);
-    while (!(validAge(buffer)) && attempts < MAX_ATTEMPTS)
-    {
-        printf("Error: Invalid age. Try again: ");
-        fscanf(stdin, " %99[^\n]", buffer);
-        attempts += 1;
-    }
-    if (!(validAge(buffer)))
-    {
-        myAge = 0;
-        fprintf(stderr, "Error: Could not read a valid age\n");
-    }
-    else
-    {
-        myAge = atoi(buffer);
-    }
+void printStatistics(FILE* outputStream);
 
-    newContact = (Contact*)malloc(sizeof(Contact));
-    if (newContact == NULL)
-    {
-        fprintf(stderr, "Error: Memory allocation failed for Contact in readNewContact");
-        free(myFirstName);
-        free(myFamilyName);
-        free(myAddress);
-        return NULL;
-    }
+void countBytesWritten(long long written);
 
-    newContact->firstName = myFirstName;
-    newContact->familyName = myFamilyName;
-    newContact->address = myAddress;
-    newContact->phonNum = myPhoneNumber;
-    newContact->age = myAge;
+void resetStatistics();
 
-    return newContact;
-}
+Contact* newContactFromFields(const char* firstName, const char* familyName, const char* address, const char* phone, const char* age);
 
-Contact** appendContact(Contact **contacts, Contact *newContact)
-{
-    Contact** newContacts = NULL;
-    int numContacts = 0;
+int splitCommand(char* line, char* words[], int maxWords);
 
-    /*
-    creates a new contacts if it doesn't already exist
-    */
-    if (contacts == NULL || newContact == NULL)
-    {
-        newContacts = (Contact**)malloc(sizeof(Contact*)*2);
-        if (newContacts == NULL)
-        {
-        fprintf(stderr, "Memory reallocation error in appendContact");
-        return contacts;
-        }
-    }
-    /*
-    adds an extra space to contacts
-    */
-    else
-    {    
-        numContacts = countContacts(contacts);
+int lookupWord(const char* word, const char* const table[]);
 
-        newContacts = (Contact**)realloc(contacts, (numContacts + 2) * sizeof(Contact*));
-        if (newContacts == NULL)
-        {
-            fprintf(stderr, "Memory reallocation error in appendContact");
-            return contacts;
-        }
-    }
-    newContacts[numContacts] = newContact;
-    newContacts[numContacts + 1] = NULL;
-    contacts = newContacts;
-    printf("Contact appended successfully by appendContact\n");
-    return contacts;
-}
+bool runBatchCommand(AddressBook* book, char* line);
 
-Contact** insertContactAlphabetical(Contact** contacts, Contact* newContact)
-{
-    /*requires an non-NULL contacts*/
-	int numContacts = countContacts(contacts);
-	Contact** newContacts = NULL;
-	int index = 0;
-	if (newContact == NULL)
-	{
-		return contacts;
-	}
-	
-	newContacts = (Contact**)realloc(contacts, (numContacts + 2) * sizeof(Contact*));
-	if (newContacts == NULL)
-	{
-		fprintf(stderr, "Error: Memory reallocation error in insertContactAlphabetical");
-		return contacts;
-	}
-	newContacts[numContacts + 1] = NULL;
+int runBatchScript(AddressBook* book, FILE* script, const char* scriptName);
 
+int runBatch(AddressBook* book, int argc, char* argv[]);
 
-	/*find the correct index to place newContact*/
-    if (numContacts != 0)
-    {
-        while (index < numContacts && (strcmp(newContact->familyName, newContacts[index]->familyName) > 0 || (strcmp(newContact->familyName, newContacts[index]->familyName) == 0 && strcmp(newContact->firstName, newContacts[index]->firstName) > 0)))
-        {
-            index += 1;
-        }
-        
-        /*move all contacts down by one index*/
-        for (int i = numContacts; i > index; i--)
-        {
-            newContacts[i] = newContacts[i-1];
-        }
-    }
+unsigned long long nextRandom(unsigned long long* state);
 
+int skewedPick(unsigned long long* state, int range);
 
-	/*place contact at the index*/
-	newContacts[index] = newContact;
+void generateContactFields(unsigned long long* state, char* firstName, char* familyName, char* address, char* phone, char* age);
 
-	contacts = newContacts;
+bool generateContactsFile(const char* filename, int count, unsigned long long seed);
 
-	printf("Contact added in alphabetical order successfully.\n");
+double secondsSince(const struct timespec* start);
 
-	return contacts;
-}
+void reportTiming(bool json, const char* operation, int records, int bookSize, double seconds);
 
-void freeContact(Contact *c)
-{
-    free(c->firstName);
-    free(c->familyName);
-    free(c->address);
-    free(c);
-};
+bool timeBenchmarkOperations(AddressBook* book, char* baseFile, char* extraFile, char* saveFile, int count, int numSingle, bool json);
 
-void freeAddressBook(Contact** addressBook)
-{
-    int numContacts = countContacts(addressBook);
+bool runBenchmark(int count, bool json);
 
-    for (int i = 0; i < numContacts; i++)
-    {
-        freeContact(addressBook[i]);
-    }
-    free(addressBook);
-}
+AddressBook* createAddressBook();
 
-Contact** removeContactByIndex(Contact** contacts)
-{
-    int index = 0;
-    int originalSizeContacts = countContacts(contacts);
-    Contact** newContacts = NULL;
-    if (contacts == NULL)
-    {
-        fprintf(stderr, "Error: value of addressBook received in removeContactByIndex was NULL");
-        return NULL;
-    }
-    printf("Enter index to remove: ");
-    if (scanf("%d", &index) != 1)
-    {
-        fprintf(stderr, "Error: Value of index supplied could not be read.");
-        return contacts;
-    }
+bool reserveAddressBook(AddressBook* book, int capacity);
 
-    if (!(0 <= index && index < originalSizeContacts))
-    {
-        fprintf(stderr, "Error: Index out of range in removeContactByIndex");
-        return contacts;
-    }
+void shrinkAddressBook(AddressBook* book);
 
-    freeContact(contacts[index]);
+void* arenaAlloc(Arena* arena, size_t size);
 
-    for (int i = index; i < originalSizeContacts - 1; i ++)
-    {
-        contacts[i] = contacts[i+1];
-    }
+char* arenaCopyString(Arena* arena, const char* source, size_t length);
 
-    contacts[originalSizeContacts - 1] = NULL;
+ArenaMark arenaMark(Arena* arena);
 
-    newContacts = (Contact**)realloc(contacts, originalSizeContacts * sizeof(Contact*));
+void arenaRewind(Arena* arena, ArenaMark mark);
 
-    if (newContacts == NULL)
-    {
-        fprintf(stderr, "Error: Memory reallocation failed in removeContactByIndex");
-        return contacts;
-    }
+void freeArena(Arena* arena);
 
-    printf("Contact removed successfully.\n");
+void adoptArena(Arena* arena, Arena* other);
 
-    contacts = newContacts;
+Contact* arenaNewContact(Arena* arena, const char* firstName, const char* familyName, const char* address);
 
-    return contacts;
-}
+char* inlineContactString(Contact* c, size_t* used, const char* value, size_t length);
 
-int removeContactByFullName(Contact** contacts)
-{
-    char firstName[100] = {"\0"};
-    char familyName[100] = {"\0"};
-    int index = 0;
-    int contactsSize = countContacts(contacts);
-    Contact** newContacts = NULL;
-    
-    if (contacts == NULL)
-    {
-        fprintf(stderr, "Error: value of contacts received in removeContactByFullName was NULL");
-        return 0;
-    }
+char* copyContactString(Contact* c, size_t* used, Arena* arena, const char* value, size_t length);
 
-    printf("Enter first name: ");
-    while (getchar() != '\n'); 
-    fscanf(stdin, "%99[^\n]", firstName);
-    printf("Enter family name: ");
-    while (getchar() != '\n'); 
-    fscanf(stdin, "%99[^\n]", familyName);
+char* ownContactString(Contact* c, size_t* used, unsigned char ownFlag, const char* value);
 
-    /*
-    find matching first and family names
-    */
-    while (index < contactsSize)
-    {
-        if (strcmp(contacts[index]->firstName, firstName) == 0 && strcmp(contacts[index]->familyName, familyName) == 0)
-        {
-            break;
-        }
-        index += 1;
-    }
-    
-    if  (index == contactsSize)
-    {
-        printf("Contact '%s %s' not found.\n", firstName, familyName);
-        printf("No Contact with name %s %s found\n", firstName, familyName);
-        return 2;
-    }
-    
-    freeContact(contacts[index]);
-    for (int i = index; i < contactsSize - 1; i++)
-    {
-        contacts[i] = contacts[i + 1];
-    }
+bool setContactString(AddressBook* book, Contact* c, char** field, unsigned char ownFlag, const char* value);
 
-    contacts[contactsSize - 1] = NULL;
+unsigned int hashFullName(const char* firstName, const char* familyName);
 
-    newContacts = (Contact**)realloc(contacts, contactsSize * sizeof(Contact*));
+bool reserveNameIndex(NameIndex* index, size_t count);
 
-    if (newContacts == NULL)
-    {
-        fprintf(stderr, "Error: Memory reallocation failed in removeContactByFullName");
-        return 2;
-    }
-    
-    contacts = newContacts;
+bool nameIndexInsert(NameIndex* index, Contact* c, int position);
 
-    printf("Contact removed successfully.\n");
-    printf("Contact '%s %s' removed successfully.\n", firstName, familyName);
-    printf("removed a Contact with name %s  %s\n", firstName, familyName);
-    return 1;
-}
+Contact* nameIndexFind(NameIndex* index, const char* firstName, const char* familyName);
 
-void listContacts(Contact** contacts)
-{
-    int numContacts = countContacts(contacts);
+void nameIndexRemove(NameIndex* index, Contact* c);
 
-    if (numContacts == 0)
-    {
-        printf("No contacts available.\n");
-    }
-    else
-    {
-        printf("Contacts List:\n");
-        for (int i = 0; i < numContacts; i++)
-        {
-            printf("%d. %s %s\n", i + 1, contacts[i]->firstName, contacts[i]->familyName);
-            printf("   Phone: %lld\n", contacts[i]->phonNum);
-            printf("   Address: %s\n", contacts[i]->address);
-            printf("   Age: %d\n", contacts[i]->age);
-        }
-    }
-}
+int* nameIndexPosition(NameIndex* index, Contact* c);
 
-void saveContactsToFile(Contact** contacts, char* filename)
-{
-    FILE* outputStream = NULL;
-    int numContacts = countContacts(contacts);
+void freeNameIndex(NameIndex* index);
 
-    if (filename == NULL)
-    {
-        fprintf(stderr, "Error: filename formal parameter passed value NULL in saveContactsToFile");
-        return;
-    }
+bool indexContact(AddressBook* book, Contact* c, int position);
 
-    if (contacts == NULL)
-    {
-        fprintf(stderr, "Error: addressBook formal parameter passed value NULL in saveContactsToFile");
-        return;
-    }
+void unindexContact(AddressBook* book, Contact* c);
 
-    outputStream = fopen(filename, "w");
-    if (outputStream == NULL)
-    {
-        fprintf(stderr, "Error file not opended in saveContactsTofile");
-        return;
-    }
-    fprintf(outputStream, "%d\n", numContacts);
-    for (int i = 0; i < numContacts; i++)
-    {
-        fprintf(outputStream, "%s\n%s\n%s\n%lld\n%d\n", contacts[i]->firstName, contacts[i]->familyName, contacts[i]->address, contacts[i]->phonNum, contacts[i]->age);
-    }
+void contactsMoved(AddressBook* book, int distance);
 
-    printf("Contacts saved to %s\n", filename);
+void refreshContactPositions(AddressBook* book);
 
-    fclose(outputStream);
-    return;
-}
+int findContactPosition(AddressBook* book, Contact* c);
 
-void printContactsToFile(Contact** contacts, char* filename)
-{
-    FILE* outputStream = NULL;
-    int numContacts = countContacts(contacts);
+bool ensureNameIndex(AddressBook* book);
 
-    if (filename == NULL)
-    {
-        fprintf(stderr, "Error: filename formal parameter passed value NULL in printContactsToFile");
-        return;
-    }
+Contact* findContactByName(AddressBook* book, const char* firstName, const char* familyName);
 
-    if (contacts == NULL)
-    {
-        fprintf(stderr, "Error: addressBook formal parameter passed value NULL in printContactsToFile");
-        return;
-    }
+size_t hashPhoneNumber(long long phonNum);
 
-    outputStream = fopen(filename, "w");
-    if (outputStream == NULL)
-    {
-        fprintf(stderr, "Error: file not opened in printContactsToFile");
-        return;
-    }
+void phoneIndexPlace(PhoneIndex* index, Contact* c);
 
-    fprintf(outputStream, "Address Book Report\n-------------------\n");
-    for (int i = 0; i < numContacts; i++)
-    {
-        fprintf(outputStream, "%d. %s %s\n", i + 1, contacts[i]->firstName, contacts[i]->familyName);
-        fprintf(outputStream, "   Phone: %lld\n", contacts[i]->phonNum);
-        fprintf(outputStream, "   Address: %s\n", contacts[i]->address);
-        fprintf(outputStream, "   Age: %d\n\n", contacts[i]->age);
-    }
-    fprintf(outputStream, "-------------------\n");
-    fprintf(outputStream, "Total Contacts: %d\n", numContacts);
+bool reservePhoneIndex(PhoneIndex* index, size_t count);
 
-    printf("Contacts printed to %s (human-readable format).\n", filename);
+bool phoneIndexInsert(PhoneIndex* index, Contact* c);
 
-    fclose(outputStream);
+int phoneIndexFind(PhoneIndex* index, long long phonNum, Contact* matches[], int maxMatches);
 
-    return;
-}
+void phoneIndexRemove(PhoneIndex* index, Contact* c);
 
-Contact** loadContactsFromFile(Contact** addressBook, char* filename)
-{
-    FILE* inputStream = NULL;
-    int numContacts = 0;
-    Contact* newContact = NULL;
-    char getBuffer[100] = {"\0"};
-    char scanBuffer[100] = {"\0"};
-    char* myFirstName = NULL;
-    char* myFamilyName = NULL;
-    char* myAddress = NULL;
-    long long myPhoneNumber = 0;
-    int myAge = 0;
-    const int MAX_AGE = 150;
-    const int MIN_AGE = 1;
+void freePhoneIndex(PhoneIndex* index);
 
+bool ensurePhoneIndex(AddressBook* book);
 
-    inputStream = fopen(filename, "r");
-    if (inputStream == NULL)
-    {
-        fprintf(stderr, "Error: File to load not found");
-        return NULL;
-    }
+int findContactsByPhone(AddressBook* book, long long phonNum, Contact* matches[], int maxMatches);
 
-    fgets(getBuffer, sizeof(getBuffer), inputStream);
-    if (sscanf(getBuffer, "%d", &numContacts) != 1)
-    {
-        fprintf(stderr, "Error: Memory allocation error, addressBook in loadContactsFromFile");
-        fclose(inputStream);
-        return NULL;
-    }
+int findUniqueContactByPhone(AddressBook* book, long long phonNum);
 
-    if (addressBook != NULL)
-    {
-        freeAddressBook(addressBook);
-    }
+long long readPhoneNumber();
 
-    addressBook = (Contact**)calloc(numContacts + 1, sizeof(Contact*));
-    if (addressBook == NULL)
-    {
-        fprintf(stderr, "Error: Memory allocation error, addressBook in loadContactsFromFile");
-        fclose(inputStream);
-        return NULL;
-    }
-    addressBook[numContacts] = NULL;
+void printContact(AddressBook* book, Contact* c);
 
-    for (int i = 0; i < numContacts; i ++)
-    {
-        newContact = (Contact*)malloc(sizeof(Contact));
-        if (newContact == NULL)
-        {
-            fprintf(stderr, "Error: Memory allocation error, Contact %d in loadContactsFromFile", i);
-            freeAddressBook(addressBook);
-            fclose(inputStream);
-            return NULL;
-        }
+bool printContactsWithPhone(AddressBook* book, long long phonNum);
 
-        /*firstName*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        myFirstName = (char*)calloc((strlen(scanBuffer) + 1), sizeof(char));
-        if (myFirstName == NULL)
-        {
-            fprintf(stderr, "Error: Memory allocation error, memory for string in Contact %d not allocated", i);
-            free(newContact);
-            freeAddressBook(addressBook);
-            fclose(inputStream);
-            return NULL;
-        }
-        strcpy(myFirstName, scanBuffer);
-        newContact->firstName = myFirstName;
+bool findContactByPhoneInteractive(AddressBook* book);
 
-        /*familyName*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        myFamilyName = (char*)calloc((strlen(scanBuffer) + 1), sizeof(char));
-        if (myFamilyName == NULL)
-        {
-            fprintf(stderr, "Error: Memory allocation error, memory for string in Contact %d not allocated", i);
-            free(myFirstName);
-            free(newContact);
-            freeAddressBook(addressBook);
-            fclose(inputStream);
-            return NULL;
-        }
-        strcpy(myFamilyName, scanBuffer);
-        newContact->familyName = myFamilyName;
-
-        /*address*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        myAddress = (char*)calloc((strlen(scanBuffer) + 1), sizeof(char));
-        if (myAddress == NULL)
-        {
-            fprintf(stderr, "Error: Memory allocation error, memory for string in Contact %d not allocated", i);
-            free(myFirstName);
-            free(myFamilyName);
-            free(newContact);
-            freeAddressBook(addressBook);
-            fclose(inputStream);
-            return NULL;
-        }
-        strcpy(myAddress, scanBuffer);
-        newContact->address = myAddress;
+bool removeContactByPhone(AddressBook* book, long long phonNum);
 
-        /*phoneNumber*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        if (!(validPhoneNumber(scanBuffer)))
-        {
-            fprintf(stderr, "Error: Invalid phone number.");
-            myPhoneNumber = 0;
-        }
-        else
-        {
-            myPhoneNumber = atoll(scanBuffer);
-        }
-        newContact->phonNum = myPhoneNumber;
+bool removeContactByPhoneInteractive(AddressBook* book);
 
-        /*age*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%d", &myAge);
-        if (!(myAge >= MIN_AGE && myAge <= MAX_AGE))
-        {
-            fprintf(stderr, "Error: Invalid age.");
-            myAge = 0;
-        }
-        newContact->age = myAge;
-        
-        addressBook[i] = newContact;
-    }
-    printf("Contacts loaded from file: %s\n", filename);
-    fclose(inputStream);
-    return addressBook;
-}
+bool editContactAt(AddressBook* book, int index);
 
-bool nameInBook(char* firstName, char* familyName, Contact** addressBook)
-{
-    int numContacts = countContacts(addressBook);
+bool editContactByPhone(AddressBook* book);
 
-    for (int i = 0; i < numContacts; i++)
-    {
-        if (strcmp(addressBook[i]->firstName, firstName) == 0 && strcmp(addressBook[i]->familyName, familyName) == 0)
-        {
-            return true;
-        }
-    }
-    return false;
-}
+unsigned long long foldedPrefix(const char* text);
 
-Contact** appendContactsFromFile(Contact** contacts, char* filename)
-{
-    FILE* inputStream = NULL;
-    Contact* newContact = NULL;
-    Contact** newAddressBook = NULL;
-    char getBuffer[100] = {"\0"};
-    char scanBuffer[100] = {"\0"};
-    int numContacts = 0;
-    char* myFirstName = NULL;
-    char* myFamilyName = NULL;
-    char* myAddress = NULL;
-    long long myPhoneNumber = 0;
-    int myAge = 0;
-    const int MAX_AGE = 150;
-    const int MIN_AGE = 1;
-    
-    inputStream = fopen(filename, "r");
-    if (inputStream == NULL)
-    {
-        fprintf(stderr, "Error: File to load not found");
-        return NULL;
-    }
+void setPrefixEntry(PrefixEntry* entry, const char* name, int position);
 
-    fgets(getBuffer, sizeof(getBuffer), inputStream);
-    if (sscanf(getBuffer, "%d", &numContacts) != 1)
-    {
-        fprintf(stderr, "Error: failed to get number of contacts in file");
-        fclose(inputStream);
-        return NULL;
-    }
+const char* prefixEntryName(AddressBook* book, const PrefixEntry* entry, bool byFirstName);
 
-    printf("Contacts loaded from file: %s\n", filename);
+int comparePrefixEntries(AddressBook* book, const PrefixEntry* a, const PrefixEntry* b, bool byFirstName);
 
-    for (int i = 0; i < numContacts; i++)
-    {
-        newContact = (Contact*)malloc(sizeof(Contact));
-        if (newContact == NULL)
-        {
-            fprintf(stderr, "Error: Memory allocation error, Contact %d in loadContactsFromFile", i);
-            fclose(inputStream);
-            return NULL;
-        }
+void sortPrefixEntries(AddressBook* book, PrefixEntry* entries, PrefixEntry* scratch, int count, bool byFirstName);
 
-        /*firstName*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        myFirstName = (char*)calloc((strlen(scanBuffer) + 1), sizeof(char));
-        if (myFirstName == NULL)
-        {
-            fprintf(stderr, "Error: Memory allocation error, memory for string in Contact %d not allocated", i);
-            free(newContact);
-            fclose(inputStream);
-            return NULL;
-        }
-        strcpy(myFirstName, scanBuffer);
-        newContact->firstName = myFirstName;
+void freePrefixIndex(PrefixIndex* index);
 
-        /*familyName*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        myFamilyName = (char*)calloc((strlen(scanBuffer) + 1), sizeof(char));
-        if (myFamilyName == NULL)
-        {
-            fprintf(stderr, "Error: Memory allocation error, memory for string in Contact %d not allocated", i);
-            free(myFirstName);
-            free(newContact);
-            fclose(inputStream);
-            return NULL;
-        }
-        strcpy(myFamilyName, scanBuffer);
-        newContact->familyName = myFamilyName;
+bool ensurePrefixIndex(AddressBook* book);
 
-        /*address*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        myAddress = (char*)calloc((strlen(scanBuffer) + 1), sizeof(char));
-        if (myAddress == NULL)
-        {
-            fprintf(stderr, "Error: Memory allocation error, memory for string in Contact %d not allocated", i);
-            free(myFirstName);
-            free(myFamilyName);
-            free(newContact);
-            fclose(inputStream);
-            return NULL;
-        }
-        strcpy(myAddress, scanBuffer);
-        newContact->address = myAddress;
+int prefixRunStart(AddressBook* book, PrefixEntry* entries, const char* prefix, bool byFirstName);
 
-        /*phoneNumber*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        if (!(validPhoneNumber(scanBuffer)))
-        {
-            fprintf(stderr, "Error: Invalid phone number.");
-            myPhoneNumber = 0;
-        }
-        else
-        {
-            myPhoneNumber = atoll(scanBuffer);
-        }
-        newContact->phonNum = myPhoneNumber;
+int searchContactsByPrefix(AddressBook* book, const char* prefix, int positions[], int maxPositions);
 
-        /*age*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%d", &myAge);
-        if (!(myAge >= MIN_AGE && myAge <= MAX_AGE))
-        {
-            fprintf(stderr, "Error: Invalid age.");
-            myAge = 0;
-        }
-        newContact->age = myAge;
+int printPrefixMatches(AddressBook* book, const char* prefix);
 
-        /*check to see if this name is already in the book*/
-        if (nameInBook(myFirstName, myFamilyName, contacts))
-        {
-            printf("Duplicate Contact detected\n");
-            free(myFirstName);
-            free(myFamilyName);
-            free(myAddress);
-            free(newContact);
-            continue;
-        }
-        
-        newAddressBook = appendContact(contacts, newContact);
-        contacts = newAddressBook;
-    }
+bool searchContactsInteractive(AddressBook* book);
 
-    printf("Appended contacts from %s\n", filename);
-    return contacts;
-}
+bool readContactIndex(AddressBook* book, const char* prompt, int* index);
 
-Contact **mergeContactsFromFile(Contact** contacts, char* filename)
-{
-    FILE* inputStream = NULL;
-    Contact* newContact = NULL;
-    Contact** newAddressBook = NULL;
-    char getBuffer[100] = {"\0"};
+int textTrigrams(const char* text, unsigned int buckets[], int maxTrigrams);
+
+void freeTrigramIndex(TrigramIndex* index);
+
+bool ensureTrigramIndex(AddressBook* book);
+
+int boundedEditDistance(const char* a, const char* b, int limit);
+
+int fuzzyLimit(size_t length);
+
+bool trigramListContains(TrigramIndex* index, unsigned int bucket, int position);
+
+int contactDistance(Contact* c, const char* query, int limit);
+
+int compareFuzzyMatches(AddressBook* book, const FuzzyMatch* a, const FuzzyMatch* b);
+
+int fuzzySearchContacts(AddressBook* book, const char* query, FuzzyMatch matches[], int maxMatches);
+
+int considerFuzzyMatch(AddressBook* book, const char* query, int limit, int position, FuzzyMatch matches[], int maxMatches, int* kept);
+
+int printFuzzyMatches(AddressBook* book, const char* query, int maxShown);
+
+bool fuzzySearchInteractive(AddressBook* book);
+
+void freeContactColumns(ContactColumns* columns);
+
+bool ensureContactColumns(AddressBook* book);
+
+void selectAgeRangeScalar(const uint8_t* ages, int numWords, uint8_t low, uint8_t span, uint64_t* selection);
+
+void selectPhoneRangeScalar(const int64_t* phones, int numWords, int64_t low, uint64_t span, uint64_t* selection);
+
+void selectAgeRange(ContactColumns* columns, int minAge, int maxAge, uint64_t* selection);
+
+void selectPhoneRange(ContactColumns* columns, long long minPhone, long long maxPhone, uint64_t* selection);
+
+bool phonePrefixRange(const char* prefix, long long* minPhone, long long* maxPhone);
+
+int filterContacts(AddressBook* book, const ContactFilter* filter, uint64_t** selection);
+
+int selectionToIndexes(const uint64_t* selection, int count, int indexes[], int maxIndexes);
+
+int printFilterMatches(AddressBook* book, const ContactFilter* filter);
+
+bool filterContactsInteractive(AddressBook* book);
+
+void summarizeAges(const ContactColumns* columns, AgeSummary* summary);
+
+int countAreaCodes(const ContactColumns* columns, GroupCount** groups);
+
+bool growFamilyTable(FamilySlot** slots, size_t* capacity);
+
+int countFamilyNames(const ContactColumns* columns, GroupCount** groups);
+
+int compareGroupCounts(const void* a, const void* b);
+
+bool printAggregates(AddressBook* book, bool byFamily);
+
+bool printAggregatesInteractive(AddressBook* book);
+
+bool validPhoneNumber(char buffer[]);
+
+bool validAge(char buffer[]);
+
+Contact *readNewContact();
+
+bool insertContactAt(AddressBook* book, int index, Contact* newContact);
+
+int alphabeticalPosition(AddressBook* book, Contact* newContact);
+
+bool appendContact(AddressBook* book, Contact *newContact);
+
+bool insertContactAlphabetical(AddressBook* book, Contact* newContact);
+
+void freeContact(Contact *c);
+
+void clearAddressBook(AddressBook* book);
+
+void freeAddressBook(AddressBook* book);
+
+int liveContacts(AddressBook* book);
+
+int contactRank(AddressBook* book, int slot);
+
+int contactSlot(AddressBook* book, int rank);
+
+bool markTombstone(AddressBook* book, int slot);
+
+void releaseSpareCapacity(AddressBook* book);
+
+void settleRemovals(AddressBook* book);
+
+bool setDeferRemovals(const char* text);
+
+void removeContactAt(AddressBook* book, int index);
+
+bool removeContactByIndex(AddressBook* book);
+
+bool removeContactNamed(AddressBook* book, const char* firstName, const char* familyName);
+
+int removeContactByFullName(AddressBook* book);
+
+int compareNameKeys(const void* a, const void* b);
+
+bool selectNamedContacts(AddressBook* book, char* firstNames[], char* familyNames[], int numNames, uint64_t** selection);
+
+int removeSelectedContacts(AddressBook* book, const uint64_t* selection);
+
+int removeContactsMatching(AddressBook* book, const ContactFilter* filter);
+
+int removeContactsNamed(AddressBook* book, char* firstNames[], char* familyNames[], int numNames);
+
+bool removeContactsWhereInteractive(AddressBook* book);
+
+bool openOutputWriter(OutputWriter* writer, FILE* stream);
+
+void flushOutput(OutputWriter* writer);
+
+bool closeOutputWriter(OutputWriter* writer);
+
+void outputBytes(OutputWriter* writer, const char* bytes, size_t length);
+
+void outputString(OutputWriter* writer, const char* text);
+
+void outputInteger(OutputWriter* writer, long long value);
+
+void outputContactEntry(OutputWriter* writer, AddressBook* book, int number, Contact* c);
+
+void listContacts(AddressBook* book);
+
+bool ensureListView(AddressBook* book, const char* filter, int key, int order);
+
+bool listContactsPage(AddressBook* book, int offset, int pageSize, const char* filter, int key, int order);
+
+void listContactsPageInteractive(AddressBook* book);
+
+FILE* openReplacement(const char* filename, const char* mode, char** temporaryPath);
+
+bool commitReplacement(FILE* stream, char* temporaryPath, const char* filename, bool written);
+
+bool saveContactsToFile(AddressBook* book, char* filename);
+
+void printContactsToFile(AddressBook* book, char* filename);
+
+bool openRecordReader(RecordReader* reader, const char* filename);
+
+void closeRecordReader(RecordReader* reader);
+
+bool readRecordLine(RecordReader* reader, const char** line, size_t* length);
+
+long long parsePhoneNumber(const char* text, size_t length);
+
+int parseAge(const char* text, size_t length);
+
+Contact* readContactRecord(RecordReader* reader, Arena* arena, bool* endOfFile);
+
+bool readContactsFromFile(AddressBook* book, char* filename, ContactSink* sink);
+
+const char* nextLineView(const char** cursor, const char* end, size_t* length);
+
+Contact* parseMappedRecord(const char** cursor, const char* end, Arena* arena);
+
+void* countChunkLines(void* argument);
+
+void* parseChunk(void* argument);
+
+void runLoadWorkers(LoadChunk chunks[], int numChunks, void* (*work)(void*));
+
+bool readContactsParallel(AddressBook* book, const char* mapping, size_t size, ContactSink* sink);
+
+bool setLoadThreads(const char* text);
+
+bool loadContactsFromFile(AddressBook* book, char* filename);
+
+bool mapFile(const char* filename, char** mapping, size_t* size);
+
+bool loadMappedContacts(AddressBook* book, char* filename, int operation);
+
+bool loadContactsMapped(AddressBook* book, char* filename);
+
+bool loadContactsLazy(AddressBook* book, char* filename);
+
+const char* contactAddress(AddressBook* book, Contact* c, size_t* length);
+
+bool resolveAddresses(AddressBook* book);
+
+bool saveSnapshot(AddressBook* book, char* filename);
+
+char* journalPathFor(const char* baseFilename);
+
+void journalInsert(AddressBook* book, int index, Contact* c);
+
+void journalRemove(AddressBook* book, int index);
+
+void journalRemoveSelection(AddressBook* book, const uint64_t* selection, int count);
+
+void journalEdit(AddressBook* book, int index, int field, const char* value);
+
+void journalSort(AddressBook* book, int key, int order);
+
+void closeJournal(AddressBook* book);
+
+int replayJournal(AddressBook* book, const char* journalPath);
+
+bool openJournaledBook(AddressBook* book, char* baseFilename);
+
+bool compactJournal(AddressBook* book);
+
+bool loadSnapshot(AddressBook* book, char* filename);
+
+bool nameInBook(char* firstName, char* familyName, AddressBook* book);
+
+bool appendContactsFromFile(AddressBook* book, char* filename);
+
+int compareContactNames(const Contact* a, const Contact* b);
+
+int compareContactAddresses(const Contact* a, const Contact* b);
+
+unsigned long long stringPrefix(const char* text);
+
+unsigned long long familyNamePrefix(const Contact* c);
+
+unsigned long long addressPrefix(const Contact* c);
+
+int compareSortEntries(const SortEntry* a, const SortEntry* b, int (*compare)(const Contact*, const Contact*), bool descending);
+
+void InsertionSort(SortEntry* entries, int count, int (*compare)(const Contact*, const Contact*), bool descending);
+
+bool mergeSortContacts(Contact** items, int count, int (*compare)(const Contact*, const Contact*), unsigned long long (*prefixOf)(const Contact*), bool descending);
+
+bool mergeSortedContacts(AddressBook* book, Contact** incoming, int numIncoming);
+
+bool spliceSortedContacts(AddressBook* book, Contact** incoming, int numIncoming);
+
+void abandonMerge(AddressBook* book, Contact** incoming, int numIncoming);
+
+bool countingSortByAge(Contact** items, Contact** scratch, int count, bool descending);
+
+bool radixSortByPhone(Contact** items, Contact** scratch, int count, bool descending);
+
+bool sortContacts(AddressBook* book, int key, int order);
+
+bool sortContactArray(Contact** items, int count, int key, bool descending);
+
+void sortContactsInteractive(AddressBook* book);
+
+bool mergeContactsFromFile(AddressBook* book, char* filename);
+
+bool contactsInNameOrder(Contact** items, int count);
+
+bool mergeContactFiles(AddressBook* book, char* filenames[], int numFiles);
+
+bool mergeContactFilesTo(char* outputFilename, char* filenames[], int numFiles);
+
+void mergeContactFilesInteractive(AddressBook* book);
+
+bool applyContactEdit(AddressBook* book, int index, int field, const char* value);
+
+bool editContact(AddressBook* book);
+
+/*
+Status messages ("Contact appended...", "Contacts saved to...") are suppressed by --quiet.
+*/
+bool quietMode = false;
+
+/*
+Threads parsing text files for load, append and merge, 1 reads them serially. Set by
+--threads or the threads batch command.
+*/
+int loadThreads = 1;
+
+/*
+When set, removals leave a tombstone in their slot instead of shifting the tail down;
+see removeContactAt. Set by --tombstones or the tombstones batch command.
+*/
+bool deferRemovals = false;
+
+Statistics statistics;
+
+int main(int argc, char* argv[])
+{
+
+    int option = 0;
+    AddressBook* addressBook = NULL;
+    char filename[100] = {"\0"};
+    int status = 0;
+
+    addressBook = createAddressBook();
+    if (addressBook == NULL)
+    {
+        fprintf(stderr, "Could not allocate address book");
+        return 1;
+    }
+
+    if (argc > 1)
+    {
+        status = runBatch(addressBook, argc, argv);
+        freeAddressBook(addressBook);
+        return status;
+    }
+    
+    while (option != EXIT_OPTION)
+    {
+        printMenuOptions();
+        if (scanf("%d", &option) == EOF)
+        {
+            /*input ran out, leave instead of spinning on the menu*/
+            option = EXIT_OPTION;
+        }
+
+        /* change to use case statements*/
+        switch(option)
+        {
+            case APPEND_CONTACT_OPTION:
+                printf("Adding a constact interactively: \n");
+                appendContact(addressBook, readNewContact());
+                break;
+            case INSERT_ALPHA_OPTION:
+                printf("Inserting a contact in alphabetical order interactively: \n");
+                insertContactAlphabetical(addressBook, readNewContact());
+                break;
+            case REMOVE_CONTACT_OPTION:
+                printf("Removing a Contact by index: \n");
+                removeContactByIndex(addressBook);
+                break;
+            case REMOVE_CONTACT_NAME:
+                printf("Removing a Contact with a particular Name: \n");
+                removeContactByFullName(addressBook);
+                break;
+            case FIND_EDIT_CONTACT_OPTION:
+                editContact(addressBook);
+                break;
+            case LIST_CONTACT_OPTION:
+                printf("\n");
+                listContacts(addressBook);
+                break;
+            case PRNT_FILE_OPTION:
+                printf("Enter filename to save: ");
+                scanf("%s", filename);
+                saveContactsToFile(addressBook, filename);
+                break;
+            case PRNT_FILE_HR_OPTION:
+                printf("Enter filename to print: ");
+                scanf("%s", filename);
+                printContactsToFile(addressBook, filename);
+                break;
+            case LOAD_CONTACTS_OPTION:
+                printf("Enter filename to load (replaces current contacts): ");
+                scanf("%s", filename);
+                loadContactsFromFile(addressBook, filename);
+                break;
+            case APPEND_FILE_OPTION:
+                printf("Enter filename to append: ");
+                scanf("%s", filename);
+                appendContactsFromFile(addressBook, filename);
+                break;
+            case MERGE_FILE_OPTION:
+                printf("Enter filename to merge: ");
+                scanf("%s", filename);
+                mergeContactsFromFile(addressBook, filename);
+                break;
+            case SORT_CONTACTS_OPTION:
+                sortContactsInteractive(addressBook);
+                break;
+            case LOAD_MAPPED_OPTION:
+                printf("Enter filename to load (replaces current contacts): ");
+                scanf("%s", filename);
+                loadContactsMapped(addressBook, filename);
+                break;
+            case SAVE_SNAPSHOT_OPTION:
+                printf("Enter filename to save snapshot: ");
+                scanf("%s", filename);
+                saveSnapshot(addressBook, filename);
+                break;
+            case LOAD_SNAPSHOT_OPTION:
+                printf("Enter snapshot filename to load (replaces current contacts): ");
+                scanf("%s", filename);
+                loadSnapshot(addressBook, filename);
+                break;
+            case OPEN_JOURNAL_OPTION:
+                printf("Enter base filename of the journaled address book: ");
+                scanf("%s", filename);
+                openJournaledBook(addressBook, filename);
+                break;
+            case COMPACT_JOURNAL_OPTION:
+                compactJournal(addressBook);
+                break;
+            case STATISTICS_OPTION:
+                printStatistics(stdout);
+                break;
+            case FIND_PHONE_OPTION:
+                findContactByPhoneInteractive(addressBook);
+                break;
+            case REMOVE_PHONE_OPTION:
+                removeContactByPhoneInteractive(addressBook);
+                break;
+            case EDIT_PHONE_OPTION:
+                editContactByPhone(addressBook);
+                break;
+            case SEARCH_PREFIX_OPTION:
+                searchContactsInteractive(addressBook);
+                break;
+            case FUZZY_SEARCH_OPTION:
+                fuzzySearchInteractive(addressBook);
+                break;
+            case MERGE_FILES_OPTION:
+                mergeContactFilesInteractive(addressBook);
+                break;
+            case LIST_PAGE_OPTION:
+                printf("\n");
+                listContactsPageInteractive(addressBook);
+                break;
+            case LOAD_LAZY_OPTION:
+                printf("Enter filename to load (replaces current contacts): ");
+                scanf("%s", filename);
+                loadContactsLazy(addressBook, filename);
+                break;
+            case FILTER_OPTION:
+                filterContactsInteractive(addressBook);
+                break;
+            case AGGREGATE_OPTION:
+                printAggregatesInteractive(addressBook);
+                break;
+            case REMOVE_WHERE_OPTION:
+                removeContactsWhereInteractive(addressBook);
+                break;
+            case EXIT_OPTION:
+                printf("Exiting program. Goodbye!");
+                freeAddressBook(addressBook);
+                break;
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+void printMenuOptions()
+{
+    printf("Address Book Menu:\n1.  Append Contact\n2.  Insert Contact in Alphabetical Order\n3.  Remove Contact by Index\n");
+    printf("4.  Remove Contact by Full Name\n5.  Find and Edit Contact\n6.  List Contacts\n7.  Print Contacts to File with the format of an input file\n");
+    printf("8.  Print Contacts to File (Human Readable)\n9.  Load Contacts from File Replacing Existing Contacts\n10. Append Contacts from File\n");
+    printf("11. Merge Contacts from File\n12. Exit\n13. Sort Contacts\n");
+    printf("14. Load Contacts from File (Memory Mapped)\n15. Save Binary Snapshot\n16. Load Binary Snapshot\n");
+    printf("17. Open Journaled Address Book\n18. Compact Journal\n19. Statistics\n");
+    printf("20. Find Contact by Phone Number\n21. Remove Contact by Phone Number\n22. Edit Contact by Phone Number\n");
+    printf("23. Search Contacts by Name Prefix\n24. Fuzzy Search Contacts by Name\n25. Merge Contacts from Several Files\n");
+    printf("26. List Contacts by Page\n27. Load Contacts from File (Addresses Read on Demand)\n");
+    printf("28. Filter Contacts by Age and Phone Prefix\n");
+    printf("29. Summarize Contacts by Age and Area Code or Family Name\n");
+    printf("30. Remove Contacts by Age, Missing Age or Phone, or Name List\n");
+    printf("Choose an option: ");
+}
+
+void report(const char* format, ...)
+{
+    va_list arguments;
+
+    if (quietMode)
+    {
+        return;
+    }
+    va_start(arguments, format);
+    vprintf(format, arguments);
+    va_end(arguments);
+}
+
+AddressBook* createAddressBook()
+{
+    AddressBook* book = (AddressBook*)allocate(sizeof(AddressBook));
+    if (book == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in createAddressBook");
+        return NULL;
+    }
+    book->contacts = NULL;
+    book->count = 0;
+    book->capacity = 0;
+    book->arena.slabs = NULL;
+    book->arena.nextSlabSize = 0;
+    book->arena.threadOwned = false;
+    book->arena.blockCount = 0;
+    book->arena.slabCount = 0;
+    book->ownedContacts = 0;
+    book->names.slots = NULL;
+    book->names.capacity = 0;
+    book->names.count = 0;
+    book->namesDeferred = false;
+    book->positionDrift = 0;
+    book->phones.slots = NULL;
+    book->phones.capacity = 0;
+    book->phones.count = 0;
+    book->phonesDeferred = true;
+    book->version = 0;
+    book->prefixes.byFamilyName = NULL;
+    book->prefixes.byFirstName = NULL;
+    book->prefixes.count = 0;
+    book->prefixes.builtVersion = 0;
+    book->trigrams.bucketStarts = NULL;
+    book->trigrams.positions = NULL;
+    book->trigrams.seen = NULL;
+    book->trigrams.hits = NULL;
+    book->trigrams.candidates = NULL;
+    book->trigrams.query = 0;
+    book->trigrams.count = 0;
+    book->trigrams.builtVersion = 0;
+    book->view.contacts = NULL;
+    book->view.count = 0;
+    book->view.builtVersion = 0;
+    book->columns.phones = NULL;
+    book->columns.ages = NULL;
+    book->columns.firstNames = NULL;
+    book->columns.familyNames = NULL;
+    book->columns.count = 0;
+    book->columns.builtVersion = 0;
+    book->mapping = NULL;
+    book->mappingSize = 0;
+    book->lazyAddresses = false;
+    book->tombstones = 0;
+    book->liveSlots = NULL;
+    book->journal = NULL;
+    book->journalBase = NULL;
+    return book;
+}
+
+bool reserveAddressBook(AddressBook* book, int capacity)
+{
+    Contact** newContacts = NULL;
+    int newCapacity = 0;
+
+    if (capacity <= book->capacity)
+    {
+        return true;
+    }
+
+    /*
+    grow geometrically so repeated appends cost amortized O(1)
+    */
+    newCapacity = book->capacity < 4 ? 4 : book->capacity;
+    while (newCapacity < capacity)
+    {
+        newCapacity *= 2;
+    }
+
+    newContacts = (Contact**)reallocate(book->contacts, newCapacity * sizeof(Contact*));
+    if (newContacts == NULL)
+    {
+        fprintf(stderr, "Error: Memory reallocation failed in reserveAddressBook");
+        return false;
+    }
+    book->contacts = newContacts;
+    book->capacity = newCapacity;
+    return true;
+}
+
+void shrinkAddressBook(AddressBook* book)
+{
+    Contact** newContacts = NULL;
+
+    if (book->count == book->capacity)
+    {
+        return;
+    }
+    if (book->count == 0)
+    {
+        free(book->contacts);
+        book->contacts = NULL;
+        book->capacity = 0;
+        return;
+    }
+
+    newContacts = (Contact**)reallocate(book->contacts, book->count * sizeof(Contact*));
+    if (newContacts == NULL)
+    {
+        /*the old block is still valid, keep using it*/
+        return;
+    }
+    book->contacts = newContacts;
+    book->capacity = book->count;
+}
+
+void* arenaAlloc(Arena* arena, size_t size)
+{
+    const size_t MIN_SLAB_SIZE = 64 * 1024;
+    const size_t MAX_SLAB_SIZE = 64 * 1024 * 1024;
+    ArenaSlab* slab = arena->slabs;
+    size_t slabSize = 0;
+    void* block = NULL;
+
+    /*every block is 8-byte aligned so Contact records can share slabs with strings*/
+    size = (size + 7) & ~(size_t)7;
+
+    if (slab == NULL || slab->size - slab->used < size)
+    {
+        slabSize = arena->nextSlabSize < MIN_SLAB_SIZE ? MIN_SLAB_SIZE : arena->nextSlabSize;
+        while (slabSize < size)
+        {
+            slabSize *= 2;
+        }
+        if (arena->threadOwned)
+        {
+            /*statistics is shared between threads, adoptArena adds the count later*/
+            slab = (ArenaSlab*)malloc(sizeof(ArenaSlab) + slabSize);
+            arena->slabCount += 1;
+        }
+        else
+        {
+            slab = (ArenaSlab*)allocate(sizeof(ArenaSlab) + slabSize);
+        }
+        if (slab == NULL)
+        {
+            fprintf(stderr, "Error: Memory allocation failed in arenaAlloc");
+            return NULL;
+        }
+        slab->next = arena->slabs;
+        slab->used = 0;
+        slab->size = slabSize;
+        arena->slabs = slab;
+        arena->nextSlabSize = slabSize * 2 > MAX_SLAB_SIZE ? MAX_SLAB_SIZE : slabSize * 2;
+    }
+
+    block = slab->data + slab->used;
+    slab->used += size;
+    if (arena->threadOwned)
+    {
+        arena->blockCount += 1;
+    }
+    else
+    {
+        statistics.arenaAllocations += 1;
+    }
+    return block;
+}
+
+char* arenaCopyString(Arena* arena, const char* source, size_t length)
+{
+    char* copy = (char*)arenaAlloc(arena, length + 1);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    memcpy(copy, source, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+ArenaMark arenaMark(Arena* arena)
+{
+    ArenaMark mark;
+    mark.slab = arena->slabs;
+    mark.used = arena->slabs == NULL ? 0 : arena->slabs->used;
+    return mark;
+}
+
+/*
+Releases everything allocated since mark, used to drop records that turn out to be duplicates.
+*/
+void arenaRewind(Arena* arena, ArenaMark mark)
+{
+    ArenaSlab* next = NULL;
+
+    while (arena->slabs != mark.slab)
+    {
+        next = arena->slabs->next;
+        free(arena->slabs);
+        arena->slabs = next;
+    }
+    if (arena->slabs != NULL)
+    {
+        arena->slabs->used = mark.used;
+    }
+}
+
+void freeArena(Arena* arena)
+{
+    ArenaMark empty = {NULL, 0};
+    arenaRewind(arena, empty);
+    arena->nextSlabSize = 0;
+}
+
+/*
+Moves the slabs of other behind those of arena, so a later arenaRewind never reaches
+them, and adds up the counts a thread owned arena kept to itself.
+*/
+void adoptArena(Arena* arena, Arena* other)
+{
+    ArenaSlab** tail = &arena->slabs;
+
+    while (*tail != NULL)
+    {
+        tail = &(*tail)->next;
+    }
+    *tail = other->slabs;
+    statistics.arenaAllocations += other->blockCount;
+    statistics.heapAllocations += other->slabCount;
+    other->slabs = NULL;
+    other->blockCount = 0;
+    other->slabCount = 0;
+}
+
+Contact* arenaNewContact(Arena* arena, const char* firstName, const char* familyName, const char* address)
+{
+    ArenaMark mark = arenaMark(arena);
+    Contact* newContact = (Contact*)arenaAlloc(arena, sizeof(Contact));
+    size_t used = 0;
+    if (newContact == NULL)
+    {
+        return NULL;
+    }
+    newContact->firstName = copyContactString(newContact, &used, arena, firstName, strlen(firstName));
+    newContact->familyName = copyContactString(newContact, &used, arena, familyName, strlen(familyName));
+    newContact->address = copyContactString(newContact, &used, arena, address, strlen(address));
+    if (newContact->firstName == NULL || newContact->familyName == NULL || newContact->address == NULL)
+    {
+        arenaRewind(arena, mark);
+        return NULL;
+    }
+    newContact->phonNum = 0;
+    newContact->age = 0;
+    newContact->flags = 0;
+    return newContact;
+}
+
+/*
+Copies value into the free part of c->text, used bytes of which are taken, or returns
+NULL when it does not fit.
+*/
+char* inlineContactString(Contact* c, size_t* used, const char* value, size_t length)
+{
+    char* text = c->text + *used;
+
+    if (*used + length + 1 > CONTACT_TEXT_SIZE)
+    {
+        return NULL;
+    }
+    memcpy(text, value, length);
+    text[length] = '\0';
+    *used += length + 1;
+    return text;
+}
+
+/*
+A string of an arena contact, inline when it fits and carved from arena otherwise.
+*/
+char* copyContactString(Contact* c, size_t* used, Arena* arena, const char* value, size_t length)
+{
+    char* text = inlineContactString(c, used, value, length);
+
+    return text != NULL ? text : arenaCopyString(arena, value, length);
+}
+
+/*
+A string of a heap contact, inline when it fits and otherwise allocated on the heap
+and marked as owned with ownFlag.
+*/
+char* ownContactString(Contact* c, size_t* used, unsigned char ownFlag, const char* value)
+{
+    size_t length = strlen(value);
+    char* text = inlineContactString(c, used, value, length);
+
+    if (text != NULL)
+    {
+        return text;
+    }
+    text = (char*)allocate(length + 1);
+    if (text != NULL)
+    {
+        memcpy(text, value, length + 1);
+        c->flags |= ownFlag;
+    }
+    return text;
+}
+
+/*
+Replaces one of the strings of c. Heap owned strings are resized in place with realloc,
+strings living in the arena are left behind and replaced by a new heap copy.
+*/
+bool setContactString(AddressBook* book, Contact* c, char** field, unsigned char ownFlag, const char* value)
+{
+    char* newString = NULL;
+
+    if (c->flags & ownFlag)
+    {
+        newString = (char*)reallocate(*field, (strlen(value) + 1) * sizeof(char));
+    }
+    else
+    {
+        newString = (char*)allocate((strlen(value) + 1) * sizeof(char));
+    }
+    if (newString == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation error for string in editContact");
+        return false;
+    }
+    strcpy(newString, value);
+    *field = newString;
+
+    if (c->flags == 0)
+    {
+        book->ownedContacts += 1;
+    }
+    c->flags |= ownFlag;
+    return true;
+}
+
+/*
+FNV-1a over the first name, a separator and the family name.
+*/
+unsigned int hashFullName(const char* firstName, const char* familyName)
+{
+    unsigned int hash = 2166136261u;
+
+    for (const unsigned char* p = (const unsigned char*)firstName; *p != '\0'; p++)
+    {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    hash = (hash ^ 0xffu) * 16777619u;
+    for (const unsigned char* p = (const unsigned char*)familyName; *p != '\0'; p++)
+    {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+void nameIndexPlace(NameIndex* index, unsigned int hash, Contact* c, int position)
+{
+    size_t mask = index->capacity - 1;
+    size_t slot = hash & mask;
+
+    while (index->slots[slot].contact != NULL)
+    {
+        slot = (slot + 1) & mask;
+    }
+    index->slots[slot].hash = hash;
+    index->slots[slot].position = position;
+    index->slots[slot].contact = c;
+    index->count += 1;
+}
+
+/*
+Makes room for count entries while keeping the load factor under 3/4.
+*/
+bool reserveNameIndex(NameIndex* index, size_t count)
+{
+    NameIndexSlot* oldSlots = index->slots;
+    size_t oldCapacity = index->capacity;
+    size_t newCapacity = index->capacity < 16 ? 16 : index->capacity;
+
+    while (count * 4 >= newCapacity * 3)
+    {
+        newCapacity *= 2;
+    }
+    if (newCapacity == index->capacity)
+    {
+        return true;
+    }
+
+    index->slots = (NameIndexSlot*)allocateZeroed(newCapacity, sizeof(NameIndexSlot));
+    if (index->slots == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in reserveNameIndex");
+        index->slots = oldSlots;
+        return false;
+    }
+    index->capacity = newCapacity;
+    index->count = 0;
+    for (size_t i = 0; i < oldCapacity; i++)
+    {
+        if (oldSlots[i].contact != NULL)
+        {
+            nameIndexPlace(index, oldSlots[i].hash, oldSlots[i].contact, oldSlots[i].position);
+        }
+    }
+    free(oldSlots);
+    return true;
+}
+
+bool nameIndexInsert(NameIndex* index, Contact* c, int position)
+{
+    if (!reserveNameIndex(index, index->count + 1))
+    {
+        return false;
+    }
+    nameIndexPlace(index, hashFullName(c->firstName, c->familyName), c, position);
+    return true;
+}
+
+Contact* nameIndexFind(NameIndex* index, const char* firstName, const char* familyName)
+{
+    unsigned int hash = 0;
+    size_t mask = index->capacity - 1;
+    size_t slot = 0;
+    Contact* c = NULL;
+
+    if (index->count == 0)
+    {
+        return NULL;
+    }
+    hash = hashFullName(firstName, familyName);
+    slot = hash & mask;
+    while ((c = index->slots[slot].contact) != NULL)
+    {
+        if (index->slots[slot].hash == hash)
+        {
+            statistics.stringComparisons += 1;
+            if (strcmp(c->firstName, firstName) == 0 && strcmp(c->familyName, familyName) == 0)
+            {
+                return c;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+/*
+Removes the entry for exactly this contact. Later entries of the same cluster are
+shifted back into the hole so lookups never need tombstones.
+*/
+void nameIndexRemove(NameIndex* index, Contact* c)
+{
+    size_t mask = index->capacity - 1;
+    size_t hole = 0;
+    size_t slot = 0;
+    size_t home = 0;
+
+    if (index->count == 0)
+    {
+        return;
+    }
+    hole = hashFullName(c->firstName, c->familyName) & mask;
+    while (index->slots[hole].contact != c)
+    {
+        if (index->slots[hole].contact == NULL)
+        {
+            return;
+        }
+        hole = (hole + 1) & mask;
+    }
+
+    slot = hole;
+    while (true)
+    {
+        slot = (slot + 1) & mask;
+        if (index->slots[slot].contact == NULL)
+        {
+            break;
+        }
+        home = index->slots[slot].hash & mask;
+        /*move the entry back unless its home lies cyclically in (hole, slot]*/
+        if (((slot - home) & mask) >= ((slot - hole) & mask))
+        {
+            index->slots[hole] = index->slots[slot];
+            hole = slot;
+        }
+    }
+    index->slots[hole].contact = NULL;
+    index->count -= 1;
+}
+
+/*
+The position stored with exactly this contact, NULL if it is not indexed.
+*/
+int* nameIndexPosition(NameIndex* index, Contact* c)
+{
+    size_t mask = index->capacity - 1;
+    size_t slot = 0;
+
+    if (index->count == 0)
+    {
+        return NULL;
+    }
+    slot = hashFullName(c->firstName, c->familyName) & mask;
+    while (index->slots[slot].contact != c)
+    {
+        if (index->slots[slot].contact == NULL)
+        {
+            return NULL;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return &index->slots[slot].position;
+}
+
+void freeNameIndex(NameIndex* index)
+{
+    free(index->slots);
+    index->slots = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
+
+/*
+Every mutator of the book goes through indexContact/unindexContact so the lookup
+structures stay in step with the contacts array. position is the slot c goes to, or
+-1 when the caller does not know it yet.
+*/
+bool indexContact(AddressBook* book, Contact* c, int position)
+{
+    book->version += 1;
+    if (!book->namesDeferred && !nameIndexInsert(&book->names, c, position))
+    {
+        fprintf(stderr, "Error: could not index contact %s %s", c->firstName, c->familyName);
+        return false;
+    }
+    if (!book->phonesDeferred && !phoneIndexInsert(&book->phones, c))
+    {
+        fprintf(stderr, "Error: could not index contact %s %s", c->firstName, c->familyName);
+        if (!book->namesDeferred)
+        {
+            nameIndexRemove(&book->names, c);
+        }
+        return false;
+    }
+    return true;
+}
+
+void unindexContact(AddressBook* book, Contact* c)
+{
+    book->version += 1;
+    if (!book->namesDeferred)
+    {
+        nameIndexRemove(&book->names, c);
+    }
+    if (!book->phonesDeferred)
+    {
+        phoneIndexRemove(&book->phones, c);
+    }
+}
+
+/*
+Builds the name index of a book whose load deferred it.
+*/
+bool ensureNameIndex(AddressBook* book)
+{
+    if (!book->namesDeferred)
+    {
+        return true;
+    }
+    settleRemovals(book);
+    if (!reserveNameIndex(&book->names, book->count))
+    {
+        return false;
+    }
+    for (int i = 0; i < book->count; i++)
+    {
+        nameIndexPlace(&book->names, hashFullName(book->contacts[i]->firstName, book->contacts[i]->familyName), book->contacts[i], i);
+    }
+    book->namesDeferred = false;
+    book->positionDrift = 0;
+    return true;
+}
+
+Contact* findContactByName(AddressBook* book, const char* firstName, const char* familyName)
+{
+    if (!ensureNameIndex(book))
+    {
+        return NULL;
+    }
+    return nameIndexFind(&book->names, firstName, familyName);
+}
+
+/*
+Fibonacci hashing, the top bits of the product are the well mixed ones.
+*/
+size_t hashPhoneNumber(long long phonNum)
+{
+    return (size_t)(((unsigned long long)phonNum * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+void phoneIndexPlace(PhoneIndex* index, Contact* c)
+{
+    size_t mask = index->capacity - 1;
+    size_t slot = hashPhoneNumber(c->phonNum) & mask;
+
+    while (index->slots[slot].contact != NULL)
+    {
+        slot = (slot + 1) & mask;
+    }
+    index->slots[slot].phonNum = c->phonNum;
+    index->slots[slot].contact = c;
+    index->count += 1;
+}
+
+/*
+Makes room for count entries while keeping the load factor under 3/4.
+*/
+bool reservePhoneIndex(PhoneIndex* index, size_t count)
+{
+    PhoneIndexSlot* oldSlots = index->slots;
+    size_t oldCapacity = index->capacity;
+    size_t newCapacity = index->capacity < 16 ? 16 : index->capacity;
+
+    while (count * 4 >= newCapacity * 3)
+    {
+        newCapacity *= 2;
+    }
+    if (newCapacity == index->capacity)
+    {
+        return true;
+    }
+
+    index->slots = (PhoneIndexSlot*)allocateZeroed(newCapacity, sizeof(PhoneIndexSlot));
+    if (index->slots == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in reservePhoneIndex");
+        index->slots = oldSlots;
+        return false;
+    }
+    index->capacity = newCapacity;
+    index->count = 0;
+    for (size_t i = 0; i < oldCapacity; i++)
+    {
+        if (oldSlots[i].contact != NULL)
+        {
+            phoneIndexPlace(index, oldSlots[i].contact);
+        }
+    }
+    free(oldSlots);
+    return true;
+}
+
+bool phoneIndexInsert(PhoneIndex* index, Contact* c)
+{
+    if (!reservePhoneIndex(index, index->count + 1))
+    {
+        return false;
+    }
+    phoneIndexPlace(index, c);
+    return true;
+}
+
+/*
+Stores up to maxMatches contacts with this number in matches and returns how many
+contacts have it in total.
+*/
+int phoneIndexFind(PhoneIndex* index, long long phonNum, Contact* matches[], int maxMatches)
+{
+    size_t mask = index->capacity - 1;
+    size_t slot = 0;
+    int found = 0;
+
+    if (index->count == 0)
+    {
+        return 0;
+    }
+    slot = hashPhoneNumber(phonNum) & mask;
+    while (index->slots[slot].contact != NULL)
+    {
+        if (index->slots[slot].phonNum == phonNum)
+        {
+            if (found < maxMatches)
+            {
+                matches[found] = index->slots[slot].contact;
+            }
+            found += 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return found;
+}
+
+/*
+Removes the entry for exactly this contact, backward shifting like nameIndexRemove.
+The slot keeps the number the contact was indexed under, so c->phonNum must not
+have changed since it was inserted.
+*/
+void phoneIndexRemove(PhoneIndex* index, Contact* c)
+{
+    size_t mask = index->capacity - 1;
+    size_t hole = 0;
+    size_t slot = 0;
+    size_t home = 0;
+
+    if (index->count == 0)
+    {
+        return;
+    }
+    hole = hashPhoneNumber(c->phonNum) & mask;
+    while (index->slots[hole].contact != c)
+    {
+        if (index->slots[hole].contact == NULL)
+        {
+            return;
+        }
+        hole = (hole + 1) & mask;
+    }
+
+    slot = hole;
+    while (true)
+    {
+        slot = (slot + 1) & mask;
+        if (index->slots[slot].contact == NULL)
+        {
+            break;
+        }
+        home = hashPhoneNumber(index->slots[slot].phonNum) & mask;
+        if (((slot - home) & mask) >= ((slot - hole) & mask))
+        {
+            index->slots[hole] = index->slots[slot];
+            hole = slot;
+        }
+    }
+    index->slots[hole].contact = NULL;
+    index->count -= 1;
+}
+
+void freePhoneIndex(PhoneIndex* index)
+{
+    free(index->slots);
+    index->slots = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
+
+/*
+The phone index is only built once a phone lookup asks for it, loads do not pay for
+it. From then on indexContact/unindexContact keep it current.
+*/
+bool ensurePhoneIndex(AddressBook* book)
+{
+    if (!book->phonesDeferred)
+    {
+        return true;
+    }
+    settleRemovals(book);
+    if (!reservePhoneIndex(&book->phones, book->count))
+    {
+        return false;
+    }
+    for (int i = 0; i < book->count; i++)
+    {
+        phoneIndexPlace(&book->phones, book->contacts[i]);
+    }
+    book->phonesDeferred = false;
+    return true;
+}
+
+int findContactsByPhone(AddressBook* book, long long phonNum, Contact* matches[], int maxMatches)
+{
+    if (!ensurePhoneIndex(book))
+    {
+        return 0;
+    }
+    return phoneIndexFind(&book->phones, phonNum, matches, maxMatches);
+}
+
+/*
+Position of the only contact with this number, or -1 after reporting why there is none.
+*/
+int findUniqueContactByPhone(AddressBook* book, long long phonNum)
+{
+    Contact* match = NULL;
+    int found = findContactsByPhone(book, phonNum, &match, 1);
+
+    if (found == 0)
+    {
+        report("No Contact with phone number %lld found\n", phonNum);
+        return -1;
+    }
+    if (found > 1)
+    {
+        fprintf(stderr, "Error: %d contacts share phone number %lld, use the index instead\n", found, phonNum);
+        return -1;
+    }
+    return findContactPosition(book, match);
+}
+
+/*
+Records that contacts moved by up to distance slots, see findContactPosition.
+*/
+void contactsMoved(AddressBook* book, int distance)
+{
+    book->positionDrift = distance > INT_MAX - book->positionDrift ? INT_MAX : book->positionDrift + distance;
+}
+
+/*
+Stores every contact's slot in its name index entry again, after the contacts drifted
+too far from their positions.
+*/
+void refreshContactPositions(AddressBook* book)
+{
+    int* position = NULL;
+
+    for (int i = 0; i < book->count; i++)
+    {
+        if (book->contacts[i] != NULL && (position = nameIndexPosition(&book->names, book->contacts[i])) != NULL)
+        {
+            *position = i;
+        }
+    }
+    book->positionDrift = 0;
+}
+
+/*
+Slot of c in the contacts array, or -1. The name index entry of c remembers the slot
+(a deferred index is built first, so a contact found by phone gets the same lookup).
+Every move of the contacts is reported to contactsMoved, so c is at most positionDrift
+slots away from that position: shifts of the tail and compactions are searched for
+outward from it, and once the drift passes MAX_DRIFT, as after a sort, every position
+is refreshed in one pass. Only a contact indexed without a position is scanned for.
+*/
+int findContactPosition(AddressBook* book, Contact* c)
+{
+    const int MAX_DRIFT = 1024;
+    int* hint = NULL;
+
+    if (ensureNameIndex(book))
+    {
+        if (book->positionDrift > MAX_DRIFT)
+        {
+            refreshContactPositions(book);
+        }
+        hint = nameIndexPosition(&book->names, c);
+    }
+    for (int distance = 0; hint != NULL && *hint >= 0 && distance <= book->positionDrift; distance++)
+    {
+        if (*hint - distance >= 0 && *hint - distance < book->count && book->contacts[*hint - distance] == c)
+        {
+            *hint -= distance;
+            return *hint;
+        }
+        if (*hint + distance < book->count && book->contacts[*hint + distance] == c)
+        {
+            *hint += distance;
+            return *hint;
+        }
+    }
+    for (int i = 0; i < book->count; i++)
+    {
+        if (book->contacts[i] == c)
+        {
+            if (hint != NULL)
+            {
+                *hint = i;
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool validPhoneNumber(char buffer[])
+{
+    if (strlen(buffer) != 10 || buffer[0] == '0')
+    {
+        return false;
+    }
+    for (int i = 0; i < strlen(buffer); i++)
+    {
+        if (!isdigit(buffer[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool validAge(char buffer[])
+{
+    int myAge = 0;
+    const int MAX_AGE = 150;
+    const int MIN_AGE = 1;
+    for (int i = 0; i < strlen(buffer); i++)
+    {
+        if (!isdigit(buffer[i]))
+        {
+            return false;
+        }
+    }
+    myAge = atoi(buffer);
+    if (!(myAge >= MIN_AGE && myAge <= MAX_AGE))
+    {
+        return false;
+    }
+    return true;
+}
+
+Contact *readNewContact()
+{
+    char buffer[100] = {'\0'};
+    Contact* newContact = NULL;
+    size_t used = 0;
+    long long myPhoneNumber = 0;
+    int myAge = 0;
+    int attempts = 1;
+    const int MAX_ATTEMPTS = 5;
+
+    newContact = (Contact*)allocate(sizeof(Contact));
+    if (newContact == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for Contact in readNewContact");
+        return NULL;
+    }
+    newContact->flags = OWNS_CONTACT;
+
+    printf("Enter the first name: ");
+    fscanf(stdin, " %99[^\n]", buffer);
+    newContact->firstName = ownContactString(newContact, &used, OWNS_FIRST_NAME, buffer);
+    if (newContact->firstName == NULL)
+    {
+        fprintf(stderr, "Error: unable to allocate memory for the first name string");
+        freeContact(newContact);
+        return NULL;
+    }
+
+    printf("Enter the family name: ");
+    fscanf(stdin, " %99[^\n]", buffer);
+    newContact->familyName = ownContactString(newContact, &used, OWNS_FAMILY_NAME, buffer);
+    if (newContact->familyName == NULL)
+    {
+        fprintf(stderr, "Error: unable to allocate memory for the family name string");
+        freeContact(newContact);
+        return NULL;
+    }
+
+    printf("Enter the address: ");
+    fscanf(stdin, " %99[^\n]", buffer);
+    newContact->address = ownContactString(newContact, &used, OWNS_ADDRESS, buffer);
+    if (newContact->address == NULL)
+    {
+        fprintf(stderr, "Error: unable to allocate memory for the address string");
+        freeContact(newContact);
+        return NULL;
+    }
+
+    printf("Enter 10-digit phone number that must not start with 0: ");
+    fscanf(stdin, " %99[^\n]", buffer);
+    while (!validPhoneNumber(buffer) && attempts < MAX_ATTEMPTS)
+    {
+        printf("Error: Invalid phone number. Try again: ");
+        fscanf(stdin, " %99[^\n]", buffer);
+        attempts += 1;
+    }
+    if (!validPhoneNumber(buffer))
+    {
+        fprintf(stderr, "Error: Could not read a valid phone number\n");
+        myPhoneNumber = 0;
+    }
+    else
+    {
+        myPhoneNumber = atoll(buffer);
+    }
+
+    attempts = 1;
+
+    printf("Enter the age: ");
+    fscanf(stdin, " %99[^\n]", buffer);
+    while (!(validAge(buffer)) && attempts < MAX_ATTEMPTS)
+    {
+        printf("Error: Invalid age. Try again: ");
+        fscanf(stdin, " %99[^\n]", buffer);
+        attempts += 1;
+    }
+    if (!(validAge(buffer)))
+    {
+        myAge = 0;
+        fprintf(stderr, "Error: Could not read a valid age\n");
+    }
+    else
+    {
+        myAge = atoi(buffer);
+    }
+
+    newContact->phonNum = myPhoneNumber;
+    newContact->age = myAge;
+
+    return newContact;
+}
+
+/*
+Places newContact at index, shifting the tail down. Tombstones are settled first, so
+index is a rank. Shared by append, alphabetical insert and journal replay.
+*/
+bool insertContactAt(AddressBook* book, int index, Contact* newContact)
+{
+    settleRemovals(book);
+    if (!reserveAddressBook(book, book->count + 1))
+    {
+        fprintf(stderr, "Error: Memory reallocation error in insertContactAt");
+        return false;
+    }
+    if (!indexContact(book, newContact, index))
+    {
+        return false;
+    }
+    if (index < book->count)
+    {
+        unsigned long long start = statStart();
+        memmove(&book->contacts[index + 1], &book->contacts[index], (book->count - index) * sizeof(Contact*));
+        statStop(STAT_SHIFT_CONTACTS, start);
+        contactsMoved(book, 1);
+    }
+    book->contacts[index] = newContact;
+    book->count += 1;
+    if (newContact->flags != 0)
+    {
+        book->ownedContacts += 1;
+    }
+    journalInsert(book, index, newContact);
+    return true;
+}
+
+/*
+Index of the first contact that newContact does not sort after.
+*/
+int alphabeticalPosition(AddressBook* book, Contact* newContact)
+{
+    int index = 0;
+
+    settleRemovals(book);
+    while (index < book->count && compareContactNames(newContact, book->contacts[index]) > 0)
+    {
+        index += 1;
+    }
+    return index;
+}
+
+bool appendContact(AddressBook* book, Contact *newContact)
+{
+    unsigned long long start = statStart();
+    if (book == NULL || newContact == NULL)
+    {
+        fprintf(stderr, "Error: NULL value received in appendContact");
+        statStop(STAT_APPEND_CONTACT, start);
+        return false;
+    }
+
+    if (!insertContactAt(book, liveContacts(book), newContact))
+    {
+        fprintf(stderr, "Memory reallocation error in appendContact");
+        statStop(STAT_APPEND_CONTACT, start);
+        return false;
+    }
+    report("Contact appended successfully by appendContact\n");
+    statStop(STAT_APPEND_CONTACT, start);
+    return true;
+}
+
+bool insertContactAlphabetical(AddressBook* book, Contact* newContact)
+{
+    unsigned long long start = statStart();
+	if (newContact == NULL)
+	{
+		statStop(STAT_INSERT_ALPHABETICAL, start);
+		return false;
+	}
+
+	/*find the correct index to place newContact*/
+	if (!insertContactAt(book, alphabeticalPosition(book, newContact), newContact))
+	{
+		fprintf(stderr, "Error: Memory reallocation error in insertContactAlphabetical");
+		statStop(STAT_INSERT_ALPHABETICAL, start);
+		return false;
+	}
+
+	report("Contact added in alphabetical order successfully.\n");
+
+	statStop(STAT_INSERT_ALPHABETICAL, start);
+
+	return true;
+}
+
+void freeContact(Contact *c)
+{
+    if (c->flags & OWNS_FIRST_NAME)
+    {
+        free(c->firstName);
+    }
+    if (c->flags & OWNS_FAMILY_NAME)
+    {
+        free(c->familyName);
+    }
+    if (c->flags & OWNS_ADDRESS)
+    {
+        free(c->address);
+    }
+    if (c->flags & OWNS_CONTACT)
+    {
+        free(c);
+    }
+};
+
+/*
+Arena contacts are released with their slabs, so only contacts holding heap
+allocations need to be visited; a freshly loaded book is released in O(1).
+*/
+void clearAddressBook(AddressBook* book)
+{
+    for (int i = 0; i < book->count && book->ownedContacts > 0; i++)
+    {
+        if (book->contacts[i] != NULL && book->contacts[i]->flags != 0)
+        {
+            book->ownedContacts -= 1;
+            freeContact(book->contacts[i]);
+        }
+    }
+    freeArena(&book->arena);
+    freeNameIndex(&book->names);
+    book->namesDeferred = false;
+    book->positionDrift = 0;
+    freePhoneIndex(&book->phones);
+    book->phonesDeferred = true;
+    freePrefixIndex(&book->prefixes);
+    freeTrigramIndex(&book->trigrams);
+    free(book->view.contacts);
+    book->view.contacts = NULL;
+    freeContactColumns(&book->columns);
+    book->version += 1;
+    if (book->mapping != NULL)
+    {
+        munmap(book->mapping, book->mappingSize);
+        book->mapping = NULL;
+        book->mappingSize = 0;
+    }
+    book->lazyAddresses = false;
+    free(book->liveSlots);
+    book->liveSlots = NULL;
+    book->tombstones = 0;
+    book->count = 0;
+    book->ownedContacts = 0;
+}
+
+void freeAddressBook(AddressBook* book)
+{
+    if (book == NULL)
+    {
+        return;
+    }
+    closeJournal(book);
+    clearAddressBook(book);
+    free(book->contacts);
+    free(book);
+}
+
+/*
+While a book holds tombstones, count covers every slot and positions fall into two
+kinds: slots, which index contacts, and ranks, the position a contact has among the
+live ones, which is what the user sees and what the journal records. liveSlots is a
+Fenwick tree over the slots holding 1 for each live one, so converting either way is
+O(log n). Without tombstones the two are the same and no tree is kept.
+*/
+int liveContacts(AddressBook* book)
+{
+    return book->count - book->tombstones;
+}
+
+int contactRank(AddressBook* book, int slot)
+{
+    int rank = 0;
+
+    if (book->tombstones == 0)
+    {
+        return slot;
+    }
+    for (int i = slot; i > 0; i -= i & -i)
+    {
+        rank += book->liveSlots[i];
+    }
+    return rank;
+}
+
+int contactSlot(AddressBook* book, int rank)
+{
+    int slot = 0;
+    int step = 1;
+
+    if (book->tombstones == 0)
+    {
+        return rank;
+    }
+    while (step * 2 <= book->count)
+    {
+        step *= 2;
+    }
+    /*descend to the longest prefix of slots holding at most rank live ones*/
+    for (; step > 0; step /= 2)
+    {
+        if (slot + step <= book->count && book->liveSlots[slot + step] <= rank)
+        {
+            slot += step;
+            rank -= book->liveSlots[slot];
+        }
+    }
+    return slot;
+}
+
+/*
+Empties a slot whose contact has already been freed. The first tombstone builds the
+tree with every slot live, tree node i then covers i & -i slots.
+*/
+bool markTombstone(AddressBook* book, int slot)
+{
+    if (book->tombstones == 0)
+    {
+        book->liveSlots = (int*)allocate((book->count + 1) * sizeof(int));
+        if (book->liveSlots == NULL)
+        {
+            return false;
+        }
+        for (int i = 1; i <= book->count; i++)
+        {
+            book->liveSlots[i] = i & -i;
+        }
+    }
+    for (int i = slot + 1; i <= book->count; i += i & -i)
+    {
+        book->liveSlots[i] -= 1;
+    }
+    book->contacts[slot] = NULL;
+    book->tombstones += 1;
+    return true;
+}
+
+/*
+A single shrink after many removals, to the capacity repeated halving in
+removeContactAt would have left.
+*/
+void releaseSpareCapacity(AddressBook* book)
+{
+    int capacity = book->capacity;
+    Contact** newContacts = NULL;
+
+    while (capacity > 4 && book->count <= capacity / 4)
+    {
+        capacity /= 2;
+    }
+    if (capacity != book->capacity)
+    {
+        newContacts = (Contact**)reallocate(book->contacts, capacity * sizeof(Contact*));
+        if (newContacts != NULL)
+        {
+            book->contacts = newContacts;
+            book->capacity = capacity;
+        }
+    }
+}
+
+/*
+Slides the live contacts down over the tombstones in one stable pass. Anything that
+walks contacts or keeps positions beyond a single removal settles first.
+*/
+void settleRemovals(AddressBook* book)
+{
+    int kept = 0;
+
+    if (book->tombstones == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < book->count; i++)
+    {
+        if (book->contacts[i] != NULL)
+        {
+            book->contacts[kept++] = book->contacts[i];
+        }
+    }
+    contactsMoved(book, book->tombstones);
+    book->count = kept;
+    book->tombstones = 0;
+    free(book->liveSlots);
+    book->liveSlots = NULL;
+    book->version += 1;
+    releaseSpareCapacity(book);
+}
+
+bool setDeferRemovals(const char* text)
+{
+    if (strcmp(text, "on") != 0 && strcmp(text, "off") != 0)
+    {
+        fprintf(stderr, "Error: tombstones must be on or off\n");
+        return false;
+    }
+    deferRemovals = strcmp(text, "on") == 0;
+    return true;
+}
+
+/*
+Removes the contact at slot index. Normally the tail shifts down and the array is
+only shrunk once it falls to a quarter of its capacity so removals stay cheap. With
+deferRemovals the slot becomes a tombstone instead, and the book settles once more
+than a quarter of its slots are tombstones, so each removal costs O(log n) plus its
+share of one linear compaction.
+*/
+void removeContactAt(AddressBook* book, int index)
+{
+    if (book->contacts[index]->flags != 0)
+    {
+        book->ownedContacts -= 1;
+    }
+    unindexContact(book, book->contacts[index]);
+    freeContact(book->contacts[index]);
+    journalRemove(book, contactRank(book, index));
+    if ((deferRemovals || book->tombstones > 0) && markTombstone(book, index))
+    {
+        if (book->tombstones * 4 > book->count)
+        {
+            settleRemovals(book);
+        }
+        return;
+    }
+    memmove(&book->contacts[index], &book->contacts[index + 1], (book->count - index - 1) * sizeof(Contact*));
+    book->count -= 1;
+    contactsMoved(book, 1);
+
+    if (book->capacity > 4 && book->count <= book->capacity / 4)
+    {
+        Contact** newContacts = (Contact**)reallocate(book->contacts, (book->capacity / 2) * sizeof(Contact*));
+        if (newContacts != NULL)
+        {
+            book->contacts = newContacts;
+            book->capacity = book->capacity / 2;
+        }
+    }
+}
+
+bool removeContactByIndex(AddressBook* book)
+{
+    int index = 0;
+    if (book == NULL)
+    {
+        fprintf(stderr, "Error: value of addressBook received in removeContactByIndex was NULL");
+        return false;
+    }
+    if (!readContactIndex(book, "Enter index to remove: ", &index))
+    {
+        fprintf(stderr, "Error: Value of index supplied could not be read.");
+        return false;
+    }
+
+    if (!(0 <= index && index < liveContacts(book)))
+    {
+        fprintf(stderr, "Error: Index out of range in removeContactByIndex");
+        return false;
+    }
+
+    removeContactAt(book, contactSlot(book, index));
+
+    report("Contact removed successfully.\n");
+
+    return true;
+}
+
+/*
+Removes the contact with this full name, found through the name index.
+*/
+bool removeContactNamed(AddressBook* book, const char* firstName, const char* familyName)
+{
+    Contact* match = findContactByName(book, firstName, familyName);
+    int index = match == NULL ? -1 : findContactPosition(book, match);
+    
+    if  (index < 0)
+    {
+        report("Contact '%s %s' not found.\n", firstName, familyName);
+        report("No Contact with name %s %s found\n", firstName, familyName);
+        return false;
+    }
+    
+    removeContactAt(book, index);
+
+    report("Contact removed successfully.\n");
+    report("Contact '%s %s' removed successfully.\n", firstName, familyName);
+    report("removed a Contact with name %s  %s\n", firstName, familyName);
+    return true;
+}
+
+int removeContactByFullName(AddressBook* book)
+{
+    char firstName[100] = {"\0"};
+    char familyName[100] = {"\0"};
+    char fullName[200] = {"\0"};
+    
+    if (book == NULL)
+    {
+        fprintf(stderr, "Error: value of contacts received in removeContactByFullName was NULL");
+        return 0;
+    }
+
+    printf("Enter first name: ");
+    while (getchar() != '\n'); 
+    fscanf(stdin, "%99[^\n]", firstName);
+    /*?prefix lists the matching contacts before asking again*/
+    while (firstName[0] == '?')
+    {
+        printPrefixMatches(book, firstName + 1);
+        printf("Enter first name: ");
+        firstName[0] = '\0';
+        while (getchar() != '\n'); 
+        fscanf(stdin, "%99[^\n]", firstName);
+    }
+    printf("Enter family name: ");
+    while (getchar() != '\n'); 
+    fscanf(stdin, "%99[^\n]", familyName);
+
+    /*
+    find matching first and family names
+    */
+    if (removeContactNamed(book, firstName, familyName))
+    {
+        return 1;
+    }
+    /*only the menu suggests names, a miss in a script stays a cheap lookup*/
+    snprintf(fullName, sizeof(fullName), "%s %s", firstName, familyName);
+    if (fuzzySearchContacts(book, fullName, NULL, 0) > 0)
+    {
+        printf("Did you mean:\n");
+        printFuzzyMatches(book, fullName, 3);
+    }
+    return 2;
+}
+
+int compareNameKeys(const void* a, const void* b)
+{
+    const NameKey* left = (const NameKey*)a;
+    const NameKey* right = (const NameKey*)b;
+
+    return left->hash < right->hash ? -1 : left->hash > right->hash;
+}
+
+/*
+Selects every contact whose full name is in the list, duplicates included. The
+list is sorted by name hash so each contact costs a hash and a binary search; the
+caller frees *selection.
+*/
+bool selectNamedContacts(AddressBook* book, char* firstNames[], char* familyNames[], int numNames, uint64_t** selection)
+{
+    int numWords = 0;
+    NameKey* keys = (NameKey*)allocate((numNames + 1) * sizeof(NameKey));
+    Contact* c = NULL;
+    unsigned int hash = 0;
+    int low = 0;
+    int high = 0;
+    int middle = 0;
+
+    settleRemovals(book);
+    numWords = (book->count + 63) / 64;
+    *selection = (uint64_t*)allocateZeroed(numWords + 1, sizeof(uint64_t));
+    if (keys == NULL || *selection == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in selectNamedContacts");
+        free(keys);
+        free(*selection);
+        *selection = NULL;
+        return false;
+    }
+    for (int i = 0; i < numNames; i++)
+    {
+        keys[i].hash = hashFullName(firstNames[i], familyNames[i]);
+        keys[i].firstName = firstNames[i];
+        keys[i].familyName = familyNames[i];
+    }
+    qsort(keys, numNames, sizeof(NameKey), compareNameKeys);
+
+    for (int i = 0; i < book->count; i++)
+    {
+        c = book->contacts[i];
+        hash = hashFullName(c->firstName, c->familyName);
+        low = 0;
+        high = numNames;
+        while (low < high)
+        {
+            middle = low + (high - low) / 2;
+            if (keys[middle].hash < hash)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        for (; low < numNames && keys[low].hash == hash; low++)
+        {
+            if (strcmp(keys[low].firstName, c->firstName) == 0 && strcmp(keys[low].familyName, c->familyName) == 0)
+            {
+                (*selection)[i / 64] |= 1ULL << (i % 64);
+                break;
+            }
+        }
+    }
+    free(keys);
+    return true;
+}
+
+/*
+Removes every selected contact in one stable pass: survivors slide down over the
+gaps as they are reached, so each pointer moves at most once, and the array is
+resized once at the end. The selection is over a settled book. Returns the number
+removed.
+*/
+int removeSelectedContacts(AddressBook* book, const uint64_t* selection)
+{
+    int kept = 0;
+    int removed = 0;
+    Contact* c = NULL;
+
+    journalRemoveSelection(book, selection, book->count);
+    for (int i = 0; i < book->count; i++)
+    {
+        c = book->contacts[i];
+        if (!(selection[i / 64] >> (i % 64) & 1))
+        {
+            book->contacts[kept++] = c;
+            continue;
+        }
+        if (c->flags != 0)
+        {
+            book->ownedContacts -= 1;
+        }
+        unindexContact(book, c);
+        freeContact(c);
+    }
+    removed = book->count - kept;
+    book->count = kept;
+    if (removed > 0)
+    {
+        contactsMoved(book, removed);
+        releaseSpareCapacity(book);
+    }
+    return removed;
+}
+
+/*
+Removes the contacts a filter selects, e.g. minPhone = maxPhone = 0 for the
+placeholder the loaders store for an invalid phone number. Returns the number
+removed, -1 on failure.
+*/
+int removeContactsMatching(AddressBook* book, const ContactFilter* filter)
+{
+    uint64_t* selection = NULL;
+    int removed = filterContacts(book, filter, &selection);
+
+    if (removed > 0)
+    {
+        removed = removeSelectedContacts(book, selection);
+    }
+    free(selection);
+    if (removed >= 0)
+    {
+        report("%d contacts removed.\n", removed);
+    }
+    return removed;
+}
+
+int removeContactsNamed(AddressBook* book, char* firstNames[], char* familyNames[], int numNames)
+{
+    uint64_t* selection = NULL;
+    int removed = 0;
+
+    if (!selectNamedContacts(book, firstNames, familyNames, numNames, &selection))
+    {
+        return -1;
+    }
+    removed = removeSelectedContacts(book, selection);
+    free(selection);
+    report("%d contacts removed.\n", removed);
+    return removed;
+}
+
+bool removeContactsWhereInteractive(AddressBook* book)
+{
+    const int MAX_NAMES = 100;
+    ContactFilter filter = {0, 255, LLONG_MIN, LLONG_MAX};
+    char predicate[16] = {"\0"};
+    char firstNames[100][100];
+    char familyNames[100][100];
+    char* firstPointers[100];
+    char* familyPointers[100];
+    int numNames = 0;
+
+    printf("Remove contacts with (age/no-age/no-phone/names): ");
+    if (scanf("%15s", predicate) != 1)
+    {
+        return false;
+    }
+    if (strcmp(predicate, "age") == 0)
+    {
+        printf("Youngest age to remove: ");
+        if (scanf("%d", &filter.minAge) != 1)
+        {
+            return false;
+        }
+        printf("Oldest age to remove: ");
+        if (scanf("%d", &filter.maxAge) != 1)
+        {
+            return false;
+        }
+    }
+    else if (strcmp(predicate, "no-age") == 0)
+    {
+        filter.maxAge = 0;
+    }
+    else if (strcmp(predicate, "no-phone") == 0)
+    {
+        filter.minPhone = 0;
+        filter.maxPhone = 0;
+    }
+    else if (strcmp(predicate, "names") == 0)
+    {
+        /*one name per pair of lines, an empty first name ends the list*/
+        while (getchar() != '\n');
+        while (numNames < MAX_NAMES)
+        {
+            printf("First name (empty to finish): ");
+            firstNames[numNames][0] = '\0';
+            if (fgets(firstNames[numNames], sizeof(firstNames[numNames]), stdin) == NULL || firstNames[numNames][0] == '\n')
+            {
+                break;
+            }
+            printf("Family name: ");
+            familyNames[numNames][0] = '\0';
+            if (fgets(familyNames[numNames], sizeof(familyNames[numNames]), stdin) == NULL)
+            {
+                break;
+            }
+            firstNames[numNames][strcspn(firstNames[numNames], "\n")] = '\0';
+            familyNames[numNames][strcspn(familyNames[numNames], "\n")] = '\0';
+            firstPointers[numNames] = firstNames[numNames];
+            familyPointers[numNames] = familyNames[numNames];
+            numNames++;
+        }
+        return removeContactsNamed(book, firstPointers, familyPointers, numNames) >= 0;
+    }
+    else
+    {
+        fprintf(stderr, "Error: Unknown condition.\n");
+        return false;
+    }
+    return removeContactsMatching(book, &filter) >= 0;
+}
+
+bool openOutputWriter(OutputWriter* writer, FILE* stream)
+{
+    const size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+    writer->buffer = (char*)allocate(WRITE_BUFFER_SIZE);
+    if (writer->buffer == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in openOutputWriter");
+        return false;
+    }
+    writer->stream = stream;
+    writer->size = WRITE_BUFFER_SIZE;
+    writer->used = 0;
+    writer->failed = false;
+    return true;
+}
+
+void flushOutput(OutputWriter* writer)
+{
+    if (writer->used > 0 && fwrite(writer->buffer, 1, writer->used, writer->stream) != writer->used)
+    {
+        writer->failed = true;
+    }
+    writer->used = 0;
+}
+
+/*
+Flushes and frees the buffer but leaves the stream open. Returns false if any write failed.
+*/
+bool closeOutputWriter(OutputWriter* writer)
+{
+    flushOutput(writer);
+    free(writer->buffer);
+    writer->buffer = NULL;
+    return !writer->failed;
+}
+
+void outputBytes(OutputWriter* writer, const char* bytes, size_t length)
+{
+    if (writer->size - writer->used < length)
+    {
+        flushOutput(writer);
+        if (length > writer->size)
+        {
+            writer->failed |= fwrite(bytes, 1, length, writer->stream) != length;
+            return;
+        }
+    }
+    memcpy(writer->buffer + writer->used, bytes, length);
+    writer->used += length;
+}
+
+void outputString(OutputWriter* writer, const char* text)
+{
+    outputBytes(writer, text, strlen(text));
+}
+
+/*
+Same digits as printf("%lld"), written two at a time from a table of pairs.
+*/
+void outputInteger(OutputWriter* writer, long long value)
+{
+    static const char PAIRS[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char digits[24];
+    char* cursor = digits + sizeof(digits);
+    unsigned long long magnitude = value < 0 ? 0 - (unsigned long long)value : (unsigned long long)value;
+    unsigned int pair = 0;
+
+    while (magnitude >= 100)
+    {
+        pair = (unsigned int)(magnitude % 100) * 2;
+        magnitude /= 100;
+        cursor -= 2;
+        cursor[0] = PAIRS[pair];
+        cursor[1] = PAIRS[pair + 1];
+    }
+    if (magnitude >= 10)
+    {
+        pair = (unsigned int)magnitude * 2;
+        cursor -= 2;
+        cursor[0] = PAIRS[pair];
+        cursor[1] = PAIRS[pair + 1];
+    }
+    else
+    {
+        *--cursor = (char)('0' + magnitude);
+    }
+    if (value < 0)
+    {
+        *--cursor = '-';
+    }
+    outputBytes(writer, cursor, digits + sizeof(digits) - cursor);
+}
+
+/*
+One contact as listContacts shows it:
+    1. First Family
+       Phone: 1234567890
+       Address: ...
+       Age: 30
+*/
+void outputContactEntry(OutputWriter* writer, AddressBook* book, int number, Contact* c)
+{
+    size_t addressLength = 0;
+    const char* address = contactAddress(book, c, &addressLength);
+
+    outputInteger(writer, number);
+    outputBytes(writer, ". ", 2);
+    outputString(writer, c->firstName);
+    outputBytes(writer, " ", 1);
+    outputString(writer, c->familyName);
+    outputBytes(writer, "\n   Phone: ", 11);
+    outputInteger(writer, c->phonNum);
+    outputBytes(writer, "\n   Address: ", 13);
+    outputBytes(writer, address, addressLength);
+    outputBytes(writer, "\n   Age: ", 9);
+    outputInteger(writer, c->age);
+    outputBytes(writer, "\n", 1);
+}
+
+void listContacts(AddressBook* book)
+{
+    int numContacts = 0;
+    Contact** contacts = NULL;
+    OutputWriter writer;
+
+    settleRemovals(book);
+    numContacts = book->count;
+    contacts = book->contacts;
+
+    if (numContacts == 0)
+    {
+        printf("No contacts available.\n");
+    }
+    else if (openOutputWriter(&writer, stdout))
+    {
+        outputString(&writer, "Contacts List:\n");
+        for (int i = 0; i < numContacts; i++)
+        {
+            outputContactEntry(&writer, book, i + 1, contacts[i]);
+        }
+        closeOutputWriter(&writer);
+    }
+}
+
+/*
+Builds book->view for filter (a case-insensitive first or family name prefix, empty
+for all) and key, unless the one already there is for the same request and version.
+*/
+bool ensureListView(AddressBook* book, const char* filter, int key, int order)
+{
+    ListView* view = &book->view;
+    size_t filterLength = strlen(filter);
+    Contact* c = NULL;
+
+    settleRemovals(book);
+    if (view->contacts != NULL && view->builtVersion == book->version && view->key == key
+        && view->order == order && strcmp(view->filter, filter) == 0)
+    {
+        return true;
+    }
+
+    free(view->contacts);
+    view->contacts = (Contact**)allocate((book->count + 1) * sizeof(Contact*));
+    if (view->contacts == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation error in ensureListView");
+        return false;
+    }
+    view->count = 0;
+    for (int i = 0; i < book->count; i++)
+    {
+        c = book->contacts[i];
+        if (filterLength == 0 || strncasecmp(c->familyName, filter, filterLength) == 0
+            || strncasecmp(c->firstName, filter, filterLength) == 0)
+        {
+            view->contacts[view->count++] = c;
+        }
+    }
+    if (key != 0 && ((key == SORT_BY_ADDRESS && !resolveAddresses(book)) || !sortContactArray(view->contacts, view->count, key, order == SORT_DESCENDING)))
+    {
+        free(view->contacts);
+        view->contacts = NULL;
+        return false;
+    }
+    view->key = key;
+    view->order = order;
+    snprintf(view->filter, sizeof(view->filter), "%s", filter);
+    view->builtVersion = book->version;
+    return true;
+}
+
+/*
+Lists contacts offset .. offset + pageSize - 1 (0-based) of the book, or of its view
+for a filter or sort key, rendered into one buffered write. Without a filter or key
+the page is read straight out of the contacts array; with one, the view is built on
+the first page and every later page of it is a slice of the cached view.
+*/
+bool listContactsPage(AddressBook* book, int offset, int pageSize, const char* filter, int key, int order)
+{
+    Contact** contacts = NULL;
+    int total = 0;
+    int end = 0;
+    OutputWriter writer;
+
+    settleRemovals(book);
+    contacts = book->contacts;
+    total = book->count;
+
+    if (pageSize < 1 || offset < 0)
+    {
+        fprintf(stderr, "Error: Invalid page\n");
+        return false;
+    }
+    if (filter[0] != '\0' || key != 0)
+    {
+        if (!ensureListView(book, filter, key, order))
+        {
+            return false;
+        }
+        contacts = book->view.contacts;
+        total = book->view.count;
+    }
+    if (total == 0)
+    {
+        printf("No contacts available.\n");
+        return true;
+    }
+    if (offset >= total)
+    {
+        fprintf(stderr, "Error: offset %d is past the last of %d contacts\n", offset, total);
+        return false;
+    }
+    end = pageSize < total - offset ? offset + pageSize : total;
+
+    if (!openOutputWriter(&writer, stdout))
+    {
+        return false;
+    }
+    outputString(&writer, "Contacts ");
+    outputInteger(&writer, offset + 1);
+    outputBytes(&writer, "-", 1);
+    outputInteger(&writer, end);
+    outputString(&writer, " of ");
+    outputInteger(&writer, total);
+    outputBytes(&writer, ":\n", 2);
+    for (int i = offset; i < end; i++)
+    {
+        outputContactEntry(&writer, book, i + 1, contacts[i]);
+    }
+    return closeOutputWriter(&writer);
+}
+
+void listContactsPageInteractive(AddressBook* book)
+{
+    char filter[100] = {"\0"};
+    int pageSize = 0;
+    int key = 0;
+    int order = SORT_ASCENDING;
+    int page = 1;
+    int numPages = 0;
+
+    printf("Contacts per page: ");
+    if (scanf("%d", &pageSize) != 1 || pageSize < 1)
+    {
+        fprintf(stderr, "Error: Invalid page size");
+        return;
+    }
+    printf("Sort by (0. Book Order 1. Name 2. Age 3. Phone Number 4. Address): ");
+    if (scanf("%d", &key) != 1 || key < 0 || key > SORT_BY_ADDRESS)
+    {
+        fprintf(stderr, "Error: Invalid sort key");
+        return;
+    }
+    if (key != 0)
+    {
+        printf("Order (1. Ascending 2. Descending): ");
+        if (scanf("%d", &order) != 1 || (order != SORT_ASCENDING && order != SORT_DESCENDING))
+        {
+            fprintf(stderr, "Error: Invalid sort order");
+            return;
+        }
+    }
+    printf("Only names starting with (- for all): ");
+    if (scanf("%99s", filter) != 1)
+    {
+        return;
+    }
+    if (strcmp(filter, "-") == 0)
+    {
+        filter[0] = '\0';
+    }
+
+    while (page > 0 && listContactsPage(book, (page - 1) * pageSize, pageSize, filter, key, order))
+    {
+        numPages = ((filter[0] != '\0' || key != 0 ? book->view.count : book->count) + pageSize - 1) / pageSize;
+        if (numPages <= 1)
+        {
+            break;
+        }
+        printf("Page %d of %d. Page to show (0 to stop): ", page, numPages);
+        if (scanf("%d", &page) != 1)
+        {
+            while (getchar() != '\n' && !feof(stdin));
+            page = 0;
+        }
+        if (page > numPages)
+        {
+            page = numPages;
+        }
+    }
+}
+
+/*
+Opens "<filename>.tmp" next to filename. Writers fill the temporary file and hand it to
+commitReplacement, so the old file stays intact until the rename. A book mapped from that
+file (load-mapped, load-lazy, load-snapshot) keeps reading its old pages.
+*/
+FILE* openReplacement(const char* filename, const char* mode, char** temporaryPath)
+{
+    FILE* stream = NULL;
+
+    *temporaryPath = (char*)allocate(strlen(filename) + strlen(".tmp") + 1);
+    if (*temporaryPath == NULL)
+    {
+        return NULL;
+    }
+    strcpy(*temporaryPath, filename);
+    strcat(*temporaryPath, ".tmp");
+    stream = fopen(*temporaryPath, mode);
+    if (stream == NULL)
+    {
+        free(*temporaryPath);
+        *temporaryPath = NULL;
+    }
+    return stream;
+}
+
+/*
+Closes a stream from openReplacement and renames it over filename if everything was
+written. On failure the temporary file is removed and filename is left untouched.
+*/
+bool commitReplacement(FILE* stream, char* temporaryPath, const char* filename, bool written)
+{
+    bool replaced = false;
+
+    written = fclose(stream) == 0 && written;
+    replaced = written && rename(temporaryPath, filename) == 0;
+    if (!replaced)
+    {
+        remove(temporaryPath);
+    }
+    free(temporaryPath);
+    return replaced;
+}
+
+bool saveContactsToFile(AddressBook* book, char* filename)
+{
+    unsigned long long start = statStart();
+    FILE* outputStream = NULL;
+    char* temporaryPath = NULL;
+    OutputWriter writer;
+    Contact** contacts = NULL;
+    int numContacts = 0;
+    const char* address = NULL;
+    size_t addressLength = 0;
+    bool written = false;
+
+    if (filename == NULL)
+    {
+        fprintf(stderr, "Error: filename formal parameter passed value NULL in saveContactsToFile");
+        statStop(STAT_SAVE_FILE, start);
+        return false;
+    }
+
+    if (book == NULL)
+    {
+        fprintf(stderr, "Error: addressBook formal parameter passed value NULL in saveContactsToFile");
+        statStop(STAT_SAVE_FILE, start);
+        return false;
+    }
+    settleRemovals(book);
+    contacts = book->contacts;
+    numContacts = book->count;
+
+    outputStream = openReplacement(filename, "w", &temporaryPath);
+    if (outputStream == NULL)
+    {
+        fprintf(stderr, "Error file not opended in saveContactsTofile");
+        statStop(STAT_SAVE_FILE, start);
+        return false;
+    }
+    if (!openOutputWriter(&writer, outputStream))
+    {
+        commitReplacement(outputStream, temporaryPath, filename, false);
+        statStop(STAT_SAVE_FILE, start);
+        return false;
+    }
+    outputInteger(&writer, numContacts);
+    outputBytes(&writer, "\n", 1);
+    for (int i = 0; i < numContacts; i++)
+    {
+        outputString(&writer, contacts[i]->firstName);
+        outputBytes(&writer, "\n", 1);
+        outputString(&writer, contacts[i]->familyName);
+        outputBytes(&writer, "\n", 1);
+        address = contactAddress(book, contacts[i], &addressLength);
+        outputBytes(&writer, address, addressLength);
+        outputBytes(&writer, "\n", 1);
+        outputInteger(&writer, contacts[i]->phonNum);
+        outputBytes(&writer, "\n", 1);
+        outputInteger(&writer, contacts[i]->age);
+        outputBytes(&writer, "\n", 1);
+    }
+    written = closeOutputWriter(&writer);
+
+    countBytesWritten(ftell(outputStream));
+    if (!commitReplacement(outputStream, temporaryPath, filename, written))
+    {
+        fprintf(stderr, "Error: could not write %s in saveContactsToFile", filename);
+        statStop(STAT_SAVE_FILE, start);
+        return false;
+    }
+
+    report("Contacts saved to %s\n", filename);
+    statStop(STAT_SAVE_FILE, start);
+    return true;
+}
+
+void printContactsToFile(AddressBook* book, char* filename)
+{
+    unsigned long long start = statStart();
+    FILE* outputStream = NULL;
+    char* temporaryPath = NULL;
+    OutputWriter writer;
+    Contact** contacts = NULL;
+    int numContacts = 0;
+    bool written = false;
+
+    if (filename == NULL)
+    {
+        fprintf(stderr, "Error: filename formal parameter passed value NULL in printContactsToFile");
+        statStop(STAT_PRINT_FILE, start);
+        return;
+    }
+
+    if (book == NULL)
+    {
+        fprintf(stderr, "Error: addressBook formal parameter passed value NULL in printContactsToFile");
+        statStop(STAT_PRINT_FILE, start);
+        return;
+    }
+    settleRemovals(book);
+    contacts = book->contacts;
+    numContacts = book->count;
+
+    outputStream = openReplacement(filename, "w", &temporaryPath);
+    if (outputStream == NULL)
+    {
+        fprintf(stderr, "Error: file not opened in printContactsToFile");
+        statStop(STAT_PRINT_FILE, start);
+        return;
+    }
+    if (!openOutputWriter(&writer, outputStream))
+    {
+        commitReplacement(outputStream, temporaryPath, filename, false);
+        statStop(STAT_PRINT_FILE, start);
+        return;
+    }
+
+    outputString(&writer, "Address Book Report\n-------------------\n");
+    for (int i = 0; i < numContacts; i++)
+    {
+        outputContactEntry(&writer, book, i + 1, contacts[i]);
+        outputBytes(&writer, "\n", 1);
+    }
+    outputString(&writer, "-------------------\nTotal Contacts: ");
+    outputInteger(&writer, numContacts);
+    outputBytes(&writer, "\n", 1);
+    written = closeOutputWriter(&writer);
+
+    countBytesWritten(ftell(outputStream));
+    if (!commitReplacement(outputStream, temporaryPath, filename, written))
+    {
+        fprintf(stderr, "Error: could not write %s in printContactsToFile", filename);
+        statStop(STAT_PRINT_FILE, start);
+        return;
+    }
+
+    report("Contacts printed to %s (human-readable format).\n", filename);
+
+    statStop(STAT_PRINT_FILE, start);
+
+    return;
+}
+
+bool openRecordReader(RecordReader* reader, const char* filename)
+{
+    const size_t READ_BUFFER_SIZE = 1 << 20;
+
+    reader->stream = fopen(filename, "rb");
+    if (reader->stream == NULL)
+    {
+        return false;
+    }
+    reader->buffer = (char*)allocate(READ_BUFFER_SIZE);
+    if (reader->buffer == NULL)
+    {
+        fclose(reader->stream);
+        return false;
+    }
+    reader->size = READ_BUFFER_SIZE;
+    reader->start = 0;
+    reader->end = 0;
+    reader->eof = false;
+    return true;
+}
+
+void closeRecordReader(RecordReader* reader)
+{
+    fclose(reader->stream);
+    free(reader->buffer);
+}
+
+/*
+Hands out the next line without its newline. A line longer than the whole buffer is
+cut to its first sizeof(head) bytes, kept aside in head, and the rest of it skipped.
+Returns false at end of file.
+*/
+bool readRecordLine(RecordReader* reader, const char** line, size_t* length)
+{
+    char* newline = NULL;
+    size_t scanned = 0;
+    size_t lineLength = 0;
+
+    while (true)
+    {
+        newline = (char*)memchr(reader->buffer + reader->start + scanned, '\n', reader->end - reader->start - scanned);
+        if (newline != NULL)
+        {
+            *line = reader->buffer + reader->start;
+            *length = newline - *line;
+            reader->start += *length + 1;
+            return true;
+        }
+        scanned = reader->end - reader->start;
+
+        if (reader->eof)
+        {
+            if (scanned == 0)
+            {
+                return false;
+            }
+            /*last line without a trailing newline*/
+            *line = reader->buffer + reader->start;
+            *length = scanned;
+            reader->start = reader->end;
+            return true;
+        }
+
+        if (scanned == reader->size)
+        {
+            /*line does not fit, keep its head aside since the refills below overwrite the buffer*/
+            memcpy(reader->head, reader->buffer + reader->start, sizeof(reader->head));
+            *line = reader->head;
+            *length = sizeof(reader->head);
+            reader->start = reader->end;
+            do
+            {
+                reader->end = fread(reader->buffer, 1, reader->size, reader->stream);
+                statistics.bytesRead += reader->end;
+                newline = (char*)memchr(reader->buffer, '\n', reader->end);
+            } while (newline == NULL && reader->end == reader->size);
+            reader->start = newline == NULL ? reader->end : (size_t)(newline - reader->buffer) + 1;
+            reader->eof = newline == NULL;
+            return true;
+        }
+
+        /*move the partial line to the front and refill behind it*/
+        memmove(reader->buffer, reader->buffer + reader->start, scanned);
+        reader->start = 0;
+        reader->end = scanned;
+        lineLength = fread(reader->buffer + reader->end, 1, reader->size - reader->end, reader->stream);
+        reader->end += lineLength;
+        statistics.bytesRead += lineLength;
+        if (lineLength == 0)
+        {
+            reader->eof = true;
+        }
+    }
+}
+
+/*
+Returns the 10-digit phone number in text, or 0 when it is not one (see validPhoneNumber).
+*/
+long long parsePhoneNumber(const char* text, size_t length)
+{
+    long long number = 0;
+
+    if (length != 10 || text[0] == '0')
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        if (text[i] < '0' || text[i] > '9')
+        {
+            return 0;
+        }
+        number = number * 10 + (text[i] - '0');
+    }
+    return number;
+}
+
+/*
+Reads a leading integer like sscanf("%d") and returns it when it is a valid age, 0 otherwise.
+*/
+int parseAge(const char* text, size_t length)
+{
+    const int MAX_AGE = 150;
+    const int MIN_AGE = 1;
+    size_t i = 0;
+    int age = 0;
+    bool negative = false;
+    bool digits = false;
+
+    while (i < length && isspace((unsigned char)text[i]))
+    {
+        i++;
+    }
+    if (i < length && (text[i] == '-' || text[i] == '+'))
+    {
+        negative = text[i] == '-';
+        i++;
+    }
+    for (; i < length && text[i] >= '0' && text[i] <= '9'; i++)
+    {
+        digits = true;
+        if (age <= MAX_AGE)
+        {
+            age = age * 10 + (text[i] - '0');
+        }
+    }
+    if (!digits || negative || !(age >= MIN_AGE && age <= MAX_AGE))
+    {
+        return 0;
+    }
+    return age;
+}
+
+/*
+Parses the five lines of one record into a Contact carved from arena. Each string is
+copied once, straight from the read buffer. Fields are cut at 99 characters like the
+interactive input.
+*/
+Contact* readContactRecord(RecordReader* reader, Arena* arena, bool* endOfFile)
+{
+    const size_t MAX_FIELD_LENGTH = 99;
+    const char* line = NULL;
+    size_t length = 0;
+    Contact* newContact = NULL;
+    char** strings[3];
+    size_t used = 0;
+
+    *endOfFile = false;
+    newContact = (Contact*)arenaAlloc(arena, sizeof(Contact));
+    if (newContact == NULL)
+    {
+        return NULL;
+    }
+    strings[0] = &newContact->firstName;
+    strings[1] = &newContact->familyName;
+    strings[2] = &newContact->address;
+
+    for (int field = 0; field < 3; field++)
+    {
+        if (!readRecordLine(reader, &line, &length))
+        {
+            if (field == 0)
+            {
+                *endOfFile = true;
+                return NULL;
+            }
+            line = "";
+            length = 0;
+        }
+        *strings[field] = copyContactString(newContact, &used, arena, line, length < MAX_FIELD_LENGTH ? length : MAX_FIELD_LENGTH);
+        if (*strings[field] == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    /*phoneNumber*/
+    if (!readRecordLine(reader, &line, &length))
+    {
+        length = 0;
+    }
+    newContact->phonNum = parsePhoneNumber(line, length);
+    if (newContact->phonNum == 0)
+    {
+        fprintf(stderr, "Error: Invalid phone number.");
+    }
+
+    /*age*/
+    if (!readRecordLine(reader, &line, &length))
+    {
+        length = 0;
+    }
+    newContact->age = parseAge(line, length);
+    if (newContact->age == 0)
+    {
+        fprintf(stderr, "Error: Invalid age.");
+    }
+
+    newContact->flags = 0;
+    return newContact;
+}
+
+/*
+The one parse loop behind loading, appending and merging files: reads the record count,
+then hands every record to the sink in file order.
+*/
+bool readContactsFromFile(AddressBook* book, char* filename, ContactSink* sink)
+{
+    char* mapping = NULL;
+    size_t mappingSize = 0;
+    bool ok = false;
+    RecordReader reader;
+    const char* line = NULL;
+    size_t length = 0;
+    char header[32] = {"\0"};
+    int numContacts = 0;
+    Contact* newContact = NULL;
+    ArenaMark mark;
+    bool endOfFile = false;
+    int result = SINK_ACCEPTED;
+    unsigned long long start = 0;
+
+    if (loadThreads > 1 && mapFile(filename, &mapping, &mappingSize))
+    {
+        ok = readContactsParallel(book, mapping, mappingSize, sink);
+        munmap(mapping, mappingSize);
+        return ok;
+    }
+
+    if (!openRecordReader(&reader, filename))
+    {
+        fprintf(stderr, "Error: File to load not found");
+        return false;
+    }
+
+    if (readRecordLine(&reader, &line, &length))
+    {
+        length = length < sizeof(header) - 1 ? length : sizeof(header) - 1;
+        memcpy(header, line, length);
+        header[length] = '\0';
+    }
+    if (sscanf(header, "%d", &numContacts) != 1 || numContacts < 0)
+    {
+        fprintf(stderr, "Error: failed to get number of contacts in file");
+        closeRecordReader(&reader);
+        return false;
+    }
+
+    if (!sink->begin(book, numContacts, sink->context))
+    {
+        closeRecordReader(&reader);
+        return false;
+    }
+
+    for (int i = 0; i < numContacts; i++)
+    {
+        mark = arenaMark(&book->arena);
+        start = statStart();
+        newContact = readContactRecord(&reader, &book->arena, &endOfFile);
+        statStop(STAT_PARSE_RECORD, start);
+        if (newContact == NULL)
+        {
+            if (endOfFile)
+            {
+                fprintf(stderr, "Error: file ended after %d of %d contacts", i, numContacts);
+                break;
+            }
+            fprintf(stderr, "Error: Memory allocation error, Contact %d in readContactsFromFile", i);
+            closeRecordReader(&reader);
+            return false;
+        }
+
+        result = sink->accept(book, newContact, sink->context);
+        if (result == SINK_REJECTED)
+        {
+            arenaRewind(&book->arena, mark);
+        }
+        else if (result == SINK_FAILED)
+        {
+            closeRecordReader(&reader);
+            return false;
+        }
+    }
+
+    closeRecordReader(&reader);
+    return true;
+}
+
+/*
+Hands out the next line of a mapping as a view without its newline. Returns NULL once
+the mapping is used up.
+*/
+const char* nextLineView(const char** cursor, const char* end, size_t* length)
+{
+    const char* line = *cursor;
+    const char* newline = NULL;
+
+    if (line >= end)
+    {
+        return NULL;
+    }
+    newline = (const char*)memchr(line, '\n', end - line);
+    *length = (newline == NULL ? end : newline) - line;
+    *cursor = newline == NULL ? end : newline + 1;
+    return line;
+}
+
+/*
+readContactRecord for a loader thread: reads the five lines at cursor into a Contact
+carved from arena. Missing lines read as empty and nothing is printed, the invalid
+phone and age errors are reported when the records are handed to the sink in order.
+*/
+Contact* parseMappedRecord(const char** cursor, const char* end, Arena* arena)
+{
+    const size_t MAX_FIELD_LENGTH = 99;
+    const char* line = NULL;
+    size_t length = 0;
+    Contact* newContact = NULL;
+    char** strings[3];
+    size_t used = 0;
+
+    newContact = (Contact*)arenaAlloc(arena, sizeof(Contact));
+    if (newContact == NULL)
+    {
+        return NULL;
+    }
+    strings[0] = &newContact->firstName;
+    strings[1] = &newContact->familyName;
+    strings[2] = &newContact->address;
+
+    for (int field = 0; field < 3; field++)
+    {
+        line = nextLineView(cursor, end, &length);
+        if (line == NULL)
+        {
+            line = "";
+            length = 0;
+        }
+        *strings[field] = copyContactString(newContact, &used, arena, line, length < MAX_FIELD_LENGTH ? length : MAX_FIELD_LENGTH);
+        if (*strings[field] == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    line = nextLineView(cursor, end, &length);
+    newContact->phonNum = line == NULL ? 0 : parsePhoneNumber(line, length);
+    line = nextLineView(cursor, end, &length);
+    newContact->age = line == NULL ? 0 : parseAge(line, length);
+    newContact->flags = 0;
+    return newContact;
+}
+
+/*
+First pass of readContactsParallel, counts the lines starting in a chunk.
+*/
+void* countChunkLines(void* argument)
+{
+    LoadChunk* chunk = (LoadChunk*)argument;
+    long long lines = 0;
+
+    for (const char* cursor = chunk->begin; cursor < chunk->end; cursor++)
+    {
+        lines += *cursor == '\n';
+    }
+    if (chunk->end > chunk->begin && chunk->end[-1] != '\n')
+    {
+        /*last line of a file without a trailing newline*/
+        lines += 1;
+    }
+    chunk->lines = lines;
+    return NULL;
+}
+
+/*
+Second pass of readContactsParallel, parses the records starting in a chunk. Works on
+local copies so threads do not share cache lines through the chunks array.
+*/
+void* parseChunk(void* argument)
+{
+    LoadChunk* chunk = (LoadChunk*)argument;
+    const char* cursor = chunk->begin;
+    Arena arena = chunk->arena;
+    Contact* newContact = NULL;
+    size_t length = 0;
+    int parsed = 0;
+
+    for (int i = 0; i < chunk->skip; i++)
+    {
+        nextLineView(&cursor, chunk->fileEnd, &length);
+    }
+    for (; parsed < chunk->numRecords; parsed++)
+    {
+        newContact = parseMappedRecord(&cursor, chunk->fileEnd, &arena);
+        if (newContact == NULL)
+        {
+            chunk->failed = true;
+            break;
+        }
+        chunk->contacts[parsed] = newContact;
+    }
+    chunk->parsed = parsed;
+    chunk->arena = arena;
+    return NULL;
+}
+
+/*
+Runs work on every chunk, the first on the calling thread and the others on threads
+of their own. A chunk whose thread cannot be started is done on the calling thread.
+*/
+void runLoadWorkers(LoadChunk chunks[], int numChunks, void* (*work)(void*))
+{
+    pthread_t threads[MAX_LOAD_THREADS];
+    bool started[MAX_LOAD_THREADS];
+
+    for (int t = 1; t < numChunks; t++)
+    {
+        started[t] = pthread_create(&threads[t], NULL, work, &chunks[t]) == 0;
+    }
+    work(&chunks[0]);
+    for (int t = 1; t < numChunks; t++)
+    {
+        if (started[t])
+        {
+            pthread_join(threads[t], NULL);
+        }
+        else
+        {
+            work(&chunks[t]);
+        }
+    }
+}
+
+/*
+readContactsFromFile on loadThreads threads. The mapped file is cut into chunks at
+line starts and the lines of each chunk counted in parallel; since every record is
+five lines, the prefix sum of those counts tells each chunk where its first record
+starts. The chunks are then parsed in parallel into arenas of their own and the
+contacts handed to the sink in file order on the calling thread, which also adopts
+the arenas. Records the sink rejects keep their arena memory until the book is cleared.
+*/
+bool readContactsParallel(AddressBook* book, const char* mapping, size_t size, ContactSink* sink)
+{
+    const size_t MIN_CHUNK_SIZE = 1 << 20;
+    LoadChunk chunks[MAX_LOAD_THREADS];
+    const char* end = mapping + size;
+    const char* body = (const char*)memchr(mapping, '\n', size);
+    const char* cut = NULL;
+    char header[32] = {"\0"};
+    size_t length = 0;
+    int numContacts = 0;
+    int numChunks = 0;
+    long long lines = 0;
+    long long available = 0;
+    long long last = 0;
+    Contact* c = NULL;
+    int result = SINK_ACCEPTED;
+    bool ok = true;
+
+    statistics.bytesRead += size;
+    length = (body == NULL ? end : body) - mapping;
+    length = length < sizeof(header) - 1 ? length : sizeof(header) - 1;
+    memcpy(header, mapping, length);
+    header[length] = '\0';
+    if (sscanf(header, "%d", &numContacts) != 1 || numContacts < 0)
+    {
+        fprintf(stderr, "Error: failed to get number of contacts in file");
+        return false;
+    }
+    if (!sink->begin(book, numContacts, sink->context))
+    {
+        return false;
+    }
+    body = body == NULL ? end : body + 1;
+
+    numChunks = loadThreads;
+    if ((size_t)(end - body) / MIN_CHUNK_SIZE < (size_t)numChunks)
+    {
+        /*at least MIN_CHUNK_SIZE per thread*/
+        numChunks = (int)((size_t)(end - body) / MIN_CHUNK_SIZE) + 1;
+    }
+    for (int t = 0; t < numChunks; t++)
+    {
+        cut = body + (size_t)(end - body) / numChunks * t;
+        if (t > 0 && cut <= chunks[t - 1].begin)
+        {
+            cut = chunks[t - 1].begin;
+        }
+        else if (t > 0 && cut[-1] != '\n')
+        {
+            cut = (const char*)memchr(cut, '\n', end - cut);
+            cut = cut == NULL ? end : cut + 1;
+        }
+        memset(&chunks[t], 0, sizeof(LoadChunk));
+        chunks[t].begin = cut;
+        chunks[t].fileEnd = end;
+        chunks[t].arena.threadOwned = true;
+    }
+    for (int t = 0; t < numChunks; t++)
+    {
+        chunks[t].end = t + 1 < numChunks ? chunks[t + 1].begin : end;
+    }
+    runLoadWorkers(chunks, numChunks, countChunkLines);
+
+    for (int t = 0; t < numChunks && ok; t++)
+    {
+        chunks[t].firstLine = lines;
+        lines += chunks[t].lines;
+        /*records start on the lines that are multiples of five*/
+        available = (chunks[t].firstLine + 4) / 5;
+        last = (lines + 4) / 5 < numContacts ? (lines + 4) / 5 : numContacts;
+        chunks[t].firstRecord = (int)(available < numContacts ? available : numContacts);
+        chunks[t].skip = (int)(available * 5 - chunks[t].firstLine);
+        chunks[t].numRecords = last > available ? (int)(last - available) : 0;
+        if (chunks[t].numRecords > 0)
+        {
+            chunks[t].contacts = (Contact**)allocate(chunks[t].numRecords * sizeof(Contact*));
+            ok = chunks[t].contacts != NULL;
+        }
+    }
+    available = (lines + 4) / 5;
+
+    if (ok)
+    {
+        runLoadWorkers(chunks, numChunks, parseChunk);
+    }
+    else
+    {
+        fprintf(stderr, "Error: Memory allocation error, contacts in readContactsParallel");
+    }
+
+    for (int t = 0; t < numChunks; t++)
+    {
+        adoptArena(&book->arena, &chunks[t].arena);
+        for (int i = 0; i < chunks[t].parsed && ok; i++)
+        {
+            c = chunks[t].contacts[i];
+            if (c->phonNum == 0)
+            {
+                fprintf(stderr, "Error: Invalid phone number.");
+            }
+            if (c->age == 0)
+            {
+                fprintf(stderr, "Error: Invalid age.");
+            }
+            result = sink->accept(book, c, sink->context);
+            ok = result != SINK_FAILED;
+        }
+        if (chunks[t].failed && ok)
+        {
+            fprintf(stderr, "Error: Memory allocation error, Contact %d in readContactsFromFile", chunks[t].firstRecord + chunks[t].parsed);
+            ok = false;
+        }
+        free(chunks[t].contacts);
+    }
+
+    if (ok && available < numContacts)
+    {
+        fprintf(stderr, "Error: file ended after %lld of %d contacts", available, numContacts);
+    }
+    return ok;
+}
+
+/*
+Sets loadThreads from a count or "auto" for one per online processor.
+*/
+bool setLoadThreads(const char* text)
+{
+    long threads = strcmp(text, "auto") == 0 ? sysconf(_SC_NPROCESSORS_ONLN) : atol(text);
+
+    if (threads < 1)
+    {
+        fprintf(stderr, "Error: thread count must be a positive number or auto\n");
+        return false;
+    }
+    loadThreads = threads > MAX_LOAD_THREADS ? MAX_LOAD_THREADS : (int)threads;
+    return true;
+}
+
+bool beginLoad(AddressBook* book, int numContacts, void* context)
+{
+    /*the old contacts are only dropped once the file header has been read*/
+    *(bool*)context = true;
+    closeJournal(book);
+    clearAddressBook(book);
+    if (!reserveAddressBook(book, numContacts) || !reserveNameIndex(&book->names, numContacts))
+    {
+        fprintf(stderr, "Error: Memory allocation error, addressBook in loadContactsFromFile");
+        return false;
+    }
+    return true;
+}
+
+int acceptLoad(AddressBook* book, Contact* c, void* context)
+{
+    (void)context;
+    if (!reserveAddressBook(book, book->count + 1) || !indexContact(book, c, book->count))
+    {
+        return SINK_FAILED;
+    }
+    book->contacts[book->count] = c;
+    book->count += 1;
+    return SINK_ACCEPTED;
+}
+
+bool loadContactsFromFile(AddressBook* book, char* filename)
+{
+    unsigned long long start = statStart();
+    bool replaced = false;
+    ContactSink sink = {beginLoad, acceptLoad, &replaced};
+
+    if (!readContactsFromFile(book, filename, &sink))
+    {
+        if (replaced)
+        {
+            clearAddressBook(book);
+        }
+        statStop(STAT_LOAD_FILE, start);
+        return false;
+    }
+    report("Contacts loaded from file: %s\n", filename);
+    statStop(STAT_LOAD_FILE, start);
+    return true;
+}
+
+/*
+Maps filename read-only. Loaders hand out views into the mapping and never write to it.
+*/
+bool mapFile(const char* filename, char** mapping, size_t* size)
+{
+    int fd = open(filename, O_RDONLY);
+    struct stat info;
+    void* address = NULL;
+
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    address = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+    {
+        return false;
+    }
+    *mapping = (char*)address;
+    *size = (size_t)info.st_size;
+    return true;
+}
+
+/*
+Loads a book from a read-only mapping of filename, which stays mapped and is never
+written. Names are copied into the contact (or the arena when they do not fit) and
+phone and age parsed as usual, but an address is only recorded as where its line
+starts in the mapping. contactAddress reads it from there when the contact is
+printed, saved or edited, so addresses take no arena space and the pages holding
+them are clean file pages the kernel can drop and read back.
+*/
+bool loadMappedContacts(AddressBook* book, char* filename, int operation)
+{
+    unsigned long long start = statStart();
+    const size_t MAX_FIELD_LENGTH = 99;
+    char* mapping = NULL;
+    size_t mappingSize = 0;
+    const char* cursor = NULL;
+    const char* end = NULL;
+    const char* line = NULL;
+    size_t length = 0;
+    char header[32] = {"\0"};
+    int numContacts = 0;
+    Contact* newContact = NULL;
+    size_t used = 0;
+
+    if (!mapFile(filename, &mapping, &mappingSize))
+    {
+        fprintf(stderr, "Error: File to load not found");
+        statStop(operation, start);
+        return false;
+    }
+    cursor = mapping;
+    end = mapping + mappingSize;
+
+    line = nextLineView(&cursor, end, &length);
+    length = length < sizeof(header) - 1 ? length : sizeof(header) - 1;
+    memcpy(header, line, length);
+    header[length] = '\0';
+    if (sscanf(header, "%d", &numContacts) != 1 || numContacts < 0)
+    {
+        fprintf(stderr, "Error: failed to get number of contacts in file");
+        munmap(mapping, mappingSize);
+        statStop(operation, start);
+        return false;
+    }
+
+    closeJournal(book);
+    clearAddressBook(book);
+    book->mapping = mapping;
+    book->mappingSize = mappingSize;
+    book->lazyAddresses = true;
+    statistics.bytesRead += mappingSize;
+    if (!reserveAddressBook(book, numContacts) || !reserveNameIndex(&book->names, numContacts))
+    {
+        fprintf(stderr, "Error: Memory allocation error, addressBook in loadMappedContacts");
+        clearAddressBook(book);
+        statStop(operation, start);
+        return false;
+    }
+
+    for (int i = 0; i < numContacts; i++)
+    {
+        line = nextLineView(&cursor, end, &length);
+        if (line == NULL)
+        {
+            fprintf(stderr, "Error: file ended after %d of %d contacts", i, numContacts);
+            break;
+        }
+        newContact = (Contact*)arenaAlloc(&book->arena, sizeof(Contact));
+        if (newContact == NULL)
+        {
+            clearAddressBook(book);
+            statStop(operation, start);
+            return false;
+        }
+        used = 0;
+        newContact->firstName = copyContactString(newContact, &used, &book->arena, line, length < MAX_FIELD_LENGTH ? length : MAX_FIELD_LENGTH);
+
+        line = nextLineView(&cursor, end, &length);
+        if (line == NULL)
+        {
+            line = "";
+            length = 0;
+        }
+        newContact->familyName = copyContactString(newContact, &used, &book->arena, line, length < MAX_FIELD_LENGTH ? length : MAX_FIELD_LENGTH);
+        if (newContact->firstName == NULL || newContact->familyName == NULL)
+        {
+            clearAddressBook(book);
+            statStop(operation, start);
+            return false;
+        }
+
+        /*only where the address starts is kept, see contactAddress*/
+        line = nextLineView(&cursor, end, &length);
+        newContact->address = line == NULL ? "" : (char*)line;
+
+        /*phoneNumber*/
+        line = nextLineView(&cursor, end, &length);
+        newContact->phonNum = line == NULL ? 0 : parsePhoneNumber(line, length);
+        if (newContact->phonNum == 0)
+        {
+            fprintf(stderr, "Error: Invalid phone number.");
+        }
+
+        /*age*/
+        line = nextLineView(&cursor, end, &length);
+        newContact->age = line == NULL ? 0 : parseAge(line, length);
+        if (newContact->age == 0)
+        {
+            fprintf(stderr, "Error: Invalid age.");
+        }
+        newContact->flags = 0;
+
+        if (!indexContact(book, newContact, book->count))
+        {
+            clearAddressBook(book);
+            statStop(operation, start);
+            return false;
+        }
+        book->contacts[book->count] = newContact;
+        book->count += 1;
+    }
+
+    report("Contacts loaded from file: %s\n", filename);
+    statStop(operation, start);
+    return true;
+}
+
+/*
+Zero-copy load: names land in each contact's inline text and addresses stay in the
+mapping, see loadMappedContacts. They are copied to the heap only when editContact
+changes them.
+*/
+bool loadContactsMapped(AddressBook* book, char* filename)
+{
+    return loadMappedContacts(book, filename, STAT_LOAD_MAPPED);
+}
+
+/*
+Lazy load for books too large to keep every address in memory, see loadMappedContacts.
+*/
+bool loadContactsLazy(AddressBook* book, char* filename)
+{
+    return loadMappedContacts(book, filename, STAT_LOAD_LAZY);
+}
+
+/*
+Returns c's address and its length. After loadMappedContacts an address still in the
+mapping is read from its line there, up to the newline and cut at 99 characters like
+any loaded field; every other address is a C string.
+*/
+const char* contactAddress(AddressBook* book, Contact* c, size_t* length)
+{
+    const size_t MAX_FIELD_LENGTH = 99;
+    const char* end = book->mapping + book->mappingSize;
+    const char* newline = NULL;
+
+    if (!book->lazyAddresses || c->address < book->mapping || c->address >= end)
+    {
+        *length = strlen(c->address);
+        return c->address;
+    }
+    newline = (const char*)memchr(c->address, '\n', end - c->address);
+    *length = (newline == NULL ? end : newline) - c->address;
+    if (*length > MAX_FIELD_LENGTH)
+    {
+        *length = MAX_FIELD_LENGTH;
+    }
+    return c->address;
+}
+
+/*
+Copies every address still in the mapping into the arena, for code that compares
+addresses as C strings such as sorting by address.
+*/
+bool resolveAddresses(AddressBook* book)
+{
+    const char* address = NULL;
+    size_t length = 0;
+    Contact* c = NULL;
+
+    if (!book->lazyAddresses)
+    {
+        return true;
+    }
+    settleRemovals(book);
+    for (int i = 0; i < book->count; i++)
+    {
+        c = book->contacts[i];
+        if (c->address < book->mapping || c->address >= book->mapping + book->mappingSize)
+        {
+            continue;
+        }
+        address = contactAddress(book, c, &length);
+        c->address = arenaCopyString(&book->arena, address, length);
+        if (c->address == NULL)
+        {
+            c->address = (char*)address;
+            return false;
+        }
+    }
+    book->lazyAddresses = false;
+    return true;
+}
+
+bool saveSnapshot(AddressBook* book, char* filename)
+{
+    unsigned long long start = statStart();
+    FILE* outputStream = NULL;
+    char* temporaryPath = NULL;
+    SnapshotHeader header;
+    SnapshotRecord record;
+    uint64_t heapOffset = 0;
+    Contact* c = NULL;
+    const char* address = NULL;
+    size_t addressLength = 0;
+    bool written = true;
+
+    settleRemovals(book);
+    outputStream = openReplacement(filename, "wb", &temporaryPath);
+    if (outputStream == NULL)
+    {
+        fprintf(stderr, "Error: file not opened in saveSnapshot");
+        statStop(STAT_SAVE_SNAPSHOT, start);
+        return false;
+    }
+    setvbuf(outputStream, NULL, _IOFBF, 1 << 20);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.recordSize = sizeof(SnapshotRecord);
+    header.recordCount = book->count;
+    header.recordTableOffset = sizeof(SnapshotHeader);
+    header.stringHeapOffset = header.recordTableOffset + header.recordCount * sizeof(SnapshotRecord);
+    for (int i = 0; i < book->count; i++)
+    {
+        c = book->contacts[i];
+        contactAddress(book, c, &addressLength);
+        header.stringHeapSize += strlen(c->firstName) + strlen(c->familyName) + addressLength + 3;
+    }
+    written = fwrite(&header, sizeof(header), 1, outputStream) == 1;
+
+    /*record table, the strings are laid out in the heap in the same order*/
+    memset(&record, 0, sizeof(record));
+    for (int i = 0; i < book->count && written; i++)
+    {
+        c = book->contacts[i];
+        record.phonNum = c->phonNum;
+        record.age = (uint8_t)c->age;
+        record.firstNameLength = (uint32_t)strlen(c->firstName);
+        record.familyNameLength = (uint32_t)strlen(c->familyName);
+        contactAddress(book, c, &addressLength);
+        record.addressLength = (uint32_t)addressLength;
+        record.firstNameOffset = heapOffset;
+        record.familyNameOffset = record.firstNameOffset + record.firstNameLength + 1;
+        record.addressOffset = record.familyNameOffset + record.familyNameLength + 1;
+        heapOffset = record.addressOffset + record.addressLength + 1;
+        written = fwrite(&record, sizeof(record), 1, outputStream) == 1;
+    }
+
+    for (int i = 0; i < book->count && written; i++)
+    {
+        c = book->contacts[i];
+        address = contactAddress(book, c, &addressLength);
+        written = fwrite(c->firstName, 1, strlen(c->firstName) + 1, outputStream) == strlen(c->firstName) + 1
+            && fwrite(c->familyName, 1, strlen(c->familyName) + 1, outputStream) == strlen(c->familyName) + 1
+            && fwrite(address, 1, addressLength, outputStream) == addressLength
+            && fputc('\0', outputStream) != EOF;
+    }
+
+    countBytesWritten(ftell(outputStream));
+    if (!commitReplacement(outputStream, temporaryPath, filename, written))
+    {
+        fprintf(stderr, "Error: could not write snapshot %s", filename);
+        statStop(STAT_SAVE_SNAPSHOT, start);
+        return false;
+    }
+    report("Snapshot saved to %s\n", filename);
+    statStop(STAT_SAVE_SNAPSHOT, start);
+    return true;
+}
+
+/*
+Maps a snapshot and builds the contacts straight from its record table. Phone numbers
+and ages were validated when the snapshot was written so they are taken as they are;
+only the layout is checked. Strings stay in the mapping and the name index is built on
+first use, so opening costs one arena allocation and a pass over the record table.
+*/
+bool loadSnapshot(AddressBook* book, char* filename)
+{
+    unsigned long long start = statStart();
+    char* mapping = NULL;
+    size_t mappingSize = 0;
+    SnapshotHeader* header = NULL;
+    SnapshotRecord* records = NULL;
+    SnapshotRecord* record = NULL;
+    char* heap = NULL;
+    Contact* contacts = NULL;
+    bool valid = false;
+
+    if (!mapFile(filename, &mapping, &mappingSize))
+    {
+        fprintf(stderr, "Error: File to load not found");
+        statStop(STAT_LOAD_SNAPSHOT, start);
+        return false;
+    }
+
+    header = (SnapshotHeader*)mapping;
+    valid = mappingSize >= sizeof(SnapshotHeader)
+        && memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0
+        && header->version == SNAPSHOT_VERSION
+        && header->recordSize == sizeof(SnapshotRecord)
+        && header->recordCount <= INT32_MAX
+        && header->recordTableOffset % 8 == 0
+        && header->recordTableOffset >= sizeof(SnapshotHeader)
+        && header->recordTableOffset <= header->stringHeapOffset
+        && header->recordCount <= (header->stringHeapOffset - header->recordTableOffset) / sizeof(SnapshotRecord)
+        && header->stringHeapOffset <= mappingSize
+        && header->stringHeapSize <= mappingSize - header->stringHeapOffset
+        && (header->stringHeapSize == 0 || mapping[header->stringHeapOffset + header->stringHeapSize - 1] == '\0');
+    if (!valid)
+    {
+        fprintf(stderr, "Error: %s is not a valid address book snapshot", filename);
+        munmap(mapping, mappingSize);
+        statStop(STAT_LOAD_SNAPSHOT, start);
+        return false;
+    }
+
+    closeJournal(book);
+    clearAddressBook(book);
+    book->mapping = mapping;
+    book->mappingSize = mappingSize;
+    statistics.bytesRead += mappingSize;
+    records = (SnapshotRecord*)(mapping + header->recordTableOffset);
+    heap = mapping + header->stringHeapOffset;
+
+    if (!reserveAddressBook(book, (int)header->recordCount))
+    {
+        clearAddressBook(book);
+        statStop(STAT_LOAD_SNAPSHOT, start);
+        return false;
+    }
+    if (header->recordCount > 0)
+    {
+        contacts = (Contact*)arenaAlloc(&book->arena, header->recordCount * sizeof(Contact));
+        if (contacts == NULL)
+        {
+            clearAddressBook(book);
+            statStop(STAT_LOAD_SNAPSHOT, start);
+            return false;
+        }
+    }
+
+    for (uint64_t i = 0; i < header->recordCount; i++)
+    {
+        record = &records[i];
+        if (record->firstNameOffset >= header->stringHeapSize || record->familyNameOffset >= header->stringHeapSize || record->addressOffset >= header->stringHeapSize)
+        {
+            fprintf(stderr, "Error: record %llu of %s points outside the string heap", (unsigned long long)i, filename);
+            clearAddressBook(book);
+            statStop(STAT_LOAD_SNAPSHOT, start);
+            return false;
+        }
+        contacts[i].firstName = heap + record->firstNameOffset;
+        contacts[i].familyName = heap + record->familyNameOffset;
+        contacts[i].address = heap + record->addressOffset;
+        contacts[i].phonNum = record->phonNum;
+        contacts[i].age = record->age;
+        contacts[i].flags = 0;
+        book->contacts[i] = &contacts[i];
+    }
+    book->count = (int)header->recordCount;
+    book->namesDeferred = true;
+
+    report("Snapshot loaded from %s\n", filename);
+    statStop(STAT_LOAD_SNAPSHOT, start);
+    return true;
+}
+
+/*
+Journal of the changes made to a book since its base file was written. Each entry
+is a line naming the operation, followed by its data lines:
+    P <index>             insert at index, then the five lines of a saved contact
+    R <index>             remove the contact at index
+    E <index> <field>     edit, then the new value (field as in EditOption)
+    S <key> <order>       sortContacts
+Entries are flushed one at a time so persisting a change is a single small write.
+*/
+char* journalPathFor(const char* baseFilename)
+{
+    char* path = (char*)allocate(strlen(baseFilename) + strlen(".journal") + 1);
+    if (path != NULL)
+    {
+        strcpy(path, baseFilename);
+        strcat(path, ".journal");
+    }
+    return path;
+}
+
+void journalInsert(AddressBook* book, int index, Contact* c)
+{
+    size_t addressLength = 0;
+    const char* address = NULL;
+
+    if (book->journal == NULL)
+    {
+        return;
+    }
+    address = contactAddress(book, c, &addressLength);
+    countBytesWritten(fprintf(book->journal, "P %d\n%s\n%s\n%.*s\n%lld\n%d\n", index, c->firstName, c->familyName, (int)addressLength, address, c->phonNum, c->age));
+    fflush(book->journal);
+}
+
+void journalRemove(AddressBook* book, int index)
+{
+    if (book->journal == NULL)
+    {
+        return;
+    }
+    countBytesWritten(fprintf(book->journal, "R %d\n", index));
+    fflush(book->journal);
+}
+
+/*
+The R entries of removing every selected contact at once, each index counted
+after the removals before it, flushed together.
+*/
+void journalRemoveSelection(AddressBook* book, const uint64_t* selection, int count)
+{
+    int removed = 0;
+
+    if (book->journal == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (selection[i / 64] >> (i % 64) & 1)
+        {
+            countBytesWritten(fprintf(book->journal, "R %d\n", i - removed));
+            removed++;
+        }
+    }
+    fflush(book->journal);
+}
+
+void journalEdit(AddressBook* book, int index, int field, const char* value)
+{
+    if (book->journal == NULL)
+    {
+        return;
+    }
+    countBytesWritten(fprintf(book->journal, "E %d %d\n%s\n", index, field, value));
+    fflush(book->journal);
+}
+
+void journalSort(AddressBook* book, int key, int order)
+{
+    if (book->journal == NULL)
+    {
+        return;
+    }
+    countBytesWritten(fprintf(book->journal, "S %d %d\n", key, order));
+    fflush(book->journal);
+}
+
+void closeJournal(AddressBook* book)
+{
+    if (book->journal != NULL)
+    {
+        fclose(book->journal);
+        book->journal = NULL;
+    }
+    free(book->journalBase);
+    book->journalBase = NULL;
+}
+
+/*
+Applies the entries of journalPath to the book, stopping at the first entry that is
+incomplete or does not fit the book. Returns the number of entries applied.
+*/
+int replayJournal(AddressBook* book, const char* journalPath)
+{
+    const size_t MAX_FIELD_LENGTH = 99;
+    RecordReader reader;
+    const char* line = NULL;
+    size_t length = 0;
+    char entry[64] = {"\0"};
+    char value[100] = {"\0"};
+    char operation = '\0';
+    int first = 0;
+    int second = 0;
+    int fields = 0;
+    int applied = 0;
+    bool endOfFile = false;
+    bool ok = true;
+    Contact* newContact = NULL;
+
+    if (!openRecordReader(&reader, journalPath))
+    {
+        return 0;
+    }
+
+    while (ok && readRecordLine(&reader, &line, &length))
+    {
+        length = length < sizeof(entry) - 1 ? length : sizeof(entry) - 1;
+        memcpy(entry, line, length);
+        entry[length] = '\0';
+        fields = sscanf(entry, "%c %d %d", &operation, &first, &second);
+
+        switch (fields >= 2 ? operation : '\0')
+        {
+            case 'P':
+                newContact = readContactRecord(&reader, &book->arena, &endOfFile);
+                ok = newContact != NULL && 0 <= first && first <= liveContacts(book) && insertContactAt(book, first, newContact);
+                break;
+            case 'R':
+                ok = 0 <= first && first < liveContacts(book);
+                if (ok)
+                {
+                    removeContactAt(book, contactSlot(book, first));
+                }
+                break;
+            case 'E':
+                ok = fields == 3 && 0 <= first && first < liveContacts(book) && readRecordLine(&reader, &line, &length);
+                if (ok)
+                {
+                    length = length < MAX_FIELD_LENGTH ? length : MAX_FIELD_LENGTH;
+                    memcpy(value, line, length);
+                    value[length] = '\0';
+                    ok = applyContactEdit(book, contactSlot(book, first), second, value);
+                }
+                break;
+            case 'S':
+                ok = fields == 3 && sortContacts(book, first, second);
+                break;
+            default:
+                ok = false;
+        }
+        if (ok)
+        {
+            applied += 1;
+        }
+        else
+        {
+            fprintf(stderr, "Error: journal %s stopped at an invalid entry after %d entries\n", journalPath, applied);
+        }
+    }
+
+    closeRecordReader(&reader);
+    return applied;
+}
+
+/*
+Loads baseFilename, replays its journal and keeps the journal open so every later
+change is appended to it.
+*/
+bool openJournaledBook(AddressBook* book, char* baseFilename)
+{
+    FILE* probe = fopen(baseFilename, "r");
+    char* journalPath = journalPathFor(baseFilename);
+    int applied = 0;
+
+    if (journalPath == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation error in openJournaledBook");
+        return false;
+    }
+
+    if (probe != NULL)
+    {
+        fclose(probe);
+        if (!loadContactsFromFile(book, baseFilename))
+        {
+            free(journalPath);
+            return false;
+        }
+    }
+    else
+    {
+        closeJournal(book);
+        clearAddressBook(book);
+        report("Starting a new address book %s\n", baseFilename);
+    }
+
+    applied = replayJournal(book, journalPath);
+
+    book->journal = fopen(journalPath, "a");
+    free(journalPath);
+    if (book->journal == NULL)
+    {
+        fprintf(stderr, "Error: could not open the journal of %s", baseFilename);
+        return false;
+    }
+    book->journalBase = (char*)allocate(strlen(baseFilename) + 1);
+    if (book->journalBase == NULL)
+    {
+        closeJournal(book);
+        return false;
+    }
+    strcpy(book->journalBase, baseFilename);
+
+    report("Replayed %d journal entries for %s\n", applied, baseFilename);
+    return true;
+}
+
+/*
+Folds the journal into the base file: the book is written next to the base, renamed
+over it (see saveContactsToFile) and the journal is truncated.
+*/
+bool compactJournal(AddressBook* book)
+{
+    char* journalPath = NULL;
+
+    if (book->journal == NULL)
+    {
+        printf("No journaled address book is open.\n");
+        return false;
+    }
+
+    journalPath = journalPathFor(book->journalBase);
+    if (journalPath == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation error in compactJournal");
+        return false;
+    }
+
+    if (!saveContactsToFile(book, book->journalBase))
+    {
+        fprintf(stderr, "Error: could not rewrite %s, the journal is kept", book->journalBase);
+        free(journalPath);
+        return false;
+    }
+
+    fclose(book->journal);
+    book->journal = fopen(journalPath, "w");
+    free(journalPath);
+    if (book->journal == NULL)
+    {
+        fprintf(stderr, "Error: could not truncate the journal of %s", book->journalBase);
+        free(book->journalBase);
+        book->journalBase = NULL;
+        return false;
+    }
+
+    report("Journal compacted into %s\n", book->journalBase);
+    return true;
+}
+
+bool nameInBook(char* firstName, char* familyName, AddressBook* book)
+{
+    unsigned long long start = statStart();
+    bool found = findContactByName(book, firstName, familyName) != NULL;
+
+    statStop(STAT_NAME_IN_BOOK, start);
+    return found;
+}
+
+bool beginAppend(AddressBook* book, int numContacts, void* context)
+{
+    settleRemovals(book);
+    if (numContacts > 0 && (!reserveAddressBook(book, book->count + numContacts) || !ensureNameIndex(book) || !reserveNameIndex(&book->names, book->names.count + numContacts)))
+    {
+        fprintf(stderr, "Error: Memory allocation error in appendContactsFromFile");
+        return false;
+    }
+    report("Contacts loaded from file: %s\n", (char*)context);
+    return true;
+}
+
+int acceptAppend(AddressBook* book, Contact* c, void* context)
+{
+    (void)context;
+    /*check to see if this name is already in the book*/
+    if (nameInBook(c->firstName, c->familyName, book))
+    {
+        report("Duplicate Contact detected\n");
+        return SINK_REJECTED;
+    }
+    return appendContact(book, c) ? SINK_ACCEPTED : SINK_FAILED;
+}
+
+bool appendContactsFromFile(AddressBook* book, char* filename)
+{
+    unsigned long long start = statStart();
+    ContactSink sink = {beginAppend, acceptAppend, filename};
+
+    if (!readContactsFromFile(book, filename, &sink))
+    {
+        statStop(STAT_APPEND_FILE, start);
+        return false;
+    }
+    report("Appended contacts from %s\n", filename);
+    statStop(STAT_APPEND_FILE, start);
+    return true;
+}
+
+/*
+Family name then first name, the order kept by insertContactAlphabetical.
+*/
+int compareContactNames(const Contact* a, const Contact* b)
+{
+    int result = strcmp(a->familyName, b->familyName);
+
+    statistics.stringComparisons += 1;
+    if (result == 0)
+    {
+        result = strcmp(a->firstName, b->firstName);
+    }
+    return result;
+}
+
+int compareContactAddresses(const Contact* a, const Contact* b)
+{
+    statistics.stringComparisons += 1;
+    return strcmp(a->address, b->address);
+}
+
+/*
+First 8 bytes of a string packed big-endian, so comparing two prefixes as integers
+orders them like strcmp does. Only equal prefixes need the full comparison.
+*/
+unsigned long long stringPrefix(const char* text)
+{
+    unsigned long long prefix = 0;
+    int i = 0;
+
+    for (; i < 8 && text[i] != '\0'; i++)
+    {
+        prefix = (prefix << 8) | (unsigned char)text[i];
+    }
+    return prefix << (8 * (8 - i));
+}
+
+unsigned long long familyNamePrefix(const Contact* c)
+{
+    return stringPrefix(c->familyName);
+}
+
+unsigned long long addressPrefix(const Contact* c)
+{
+    return stringPrefix(c->address);
+}
+
+int compareSortEntries(const SortEntry* a, const SortEntry* b, int (*compare)(const Contact*, const Contact*), bool descending)
+{
+    int result = 0;
+
+    if (a->prefix != b->prefix)
+    {
+        result = a->prefix < b->prefix ? -1 : 1;
+    }
+    else
+    {
+        result = compare(a->contact, b->contact);
+    }
+    return descending ? -result : result;
+}
+
+/*
+Stable insertion sort, used on the short runs the merge sort starts from.
+*/
+void InsertionSort(SortEntry* entries, int count, int (*compare)(const Contact*, const Contact*), bool descending)
+{
+    SortEntry current;
+    int j = 0;
+
+    for (int i = 1; i < count; i++)
+    {
+        current = entries[i];
+        j = i;
+        while (j > 0 && compareSortEntries(&current, &entries[j - 1], compare, descending) < 0)
+        {
+            entries[j] = entries[j - 1];
+            j -= 1;
+        }
+        entries[j] = current;
+    }
+}
+
+/*
+Stable bottom-up merge sort. Each contact is paired with an integer prefix of its key
+so most comparisons never leave the entry array. Runs of 32 are insertion sorted
+first so the merge passes start from cache sized blocks.
+*/
+bool mergeSortContacts(Contact** items, int count, int (*compare)(const Contact*, const Contact*), unsigned long long (*prefixOf)(const Contact*), bool descending)
+{
+    SortEntry* entries = NULL;
+    SortEntry* source = NULL;
+    SortEntry* target = NULL;
+    SortEntry* swap = NULL;
+    int left = 0;
+    int middle = 0;
+    int right = 0;
+    int i = 0;
+    int j = 0;
+    int k = 0;
+    const int RUN_LENGTH = 32;
+
+    if (count < 2)
+    {
+        return true;
+    }
+    entries = (SortEntry*)allocate(2 * (size_t)count * sizeof(SortEntry));
+    if (entries == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation error in mergeSortContacts");
+        return false;
+    }
+    source = entries;
+    target = entries + count;
+    for (i = 0; i < count; i++)
+    {
+        source[i].prefix = prefixOf(items[i]);
+        source[i].contact = items[i];
+    }
+
+    for (left = 0; left < count; left += RUN_LENGTH)
+    {
+        InsertionSort(&source[left], count - left < RUN_LENGTH ? count - left : RUN_LENGTH, compare, descending);
+    }
+
+    for (int width = RUN_LENGTH; width < count; width *= 2)
+    {
+        for (left = 0; left < count; left += 2 * width)
+        {
+            middle = left + width < count ? left + width : count;
+            right = left + 2 * width < count ? left + 2 * width : count;
+            i = left;
+            j = middle;
+            k = left;
+            while (i < middle && j < right)
+            {
+                /*take from the left run on ties to stay stable*/
+                if (compareSortEntries(&source[j], &source[i], compare, descending) < 0)
+                {
+                    target[k++] = source[j++];
+                }
+                else
+                {
+                    target[k++] = source[i++];
+                }
+            }
+            while (i < middle)
+            {
+                target[k++] = source[i++];
+            }
+            while (j < right)
+            {
+                target[k++] = source[j++];
+            }
+        }
+        swap = source;
+        source = target;
+        target = swap;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        items[i] = source[i].contact;
+    }
+    free(entries);
+    return true;
+}
+
+/*
+Sorts incoming and merges it into the book, see spliceSortedContacts.
+*/
+bool mergeSortedContacts(AddressBook* book, Contact** incoming, int numIncoming)
+{
+    if (!mergeSortContacts(incoming, numIncoming, compareContactNames, familyNamePrefix, false))
+    {
+        return false;
+    }
+    return spliceSortedContacts(book, incoming, numIncoming);
+}
+
+/*
+Merges incoming, already in name order, into the book in one linear pass into a
+pre-sized array. insertContactAlphabetical places a contact before the first entry
+that is not smaller, which on a book that is not fully sorted is the first position
+whose running maximum is not smaller. Comparing against the running maximum
+reproduces that placement exactly. The incoming contacts must already be indexed
+and free of duplicates.
+*/
+bool spliceSortedContacts(AddressBook* book, Contact** incoming, int numIncoming)
+{
+    Contact** merged = NULL;
+    Contact* runningMax = NULL;
+    Contact* candidateMax = NULL;
+    int numContacts = 0;
+    int i = 0;
+    int j = 0;
+    int k = 0;
+
+    settleRemovals(book);
+    numContacts = book->count;
+
+    if (numIncoming == 0)
+    {
+        return true;
+    }
+
+    merged = (Contact**)allocate((numContacts + numIncoming) * sizeof(Contact*));
+    if (merged == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation error in spliceSortedContacts");
+        return false;
+    }
+
+    while (j < numIncoming)
+    {
+        if (i < numContacts)
+        {
+            candidateMax = runningMax;
+            if (candidateMax == NULL || compareContactNames(book->contacts[i], candidateMax) > 0)
+            {
+                candidateMax = book->contacts[i];
+            }
+            if (compareContactNames(incoming[j], candidateMax) > 0)
+            {
+                merged[k++] = book->contacts[i++];
+                runningMax = candidateMax;
+                continue;
+            }
+        }
+        if (incoming[j]->flags != 0)
+        {
+            book->ownedContacts += 1;
+        }
+        merged[k++] = incoming[j++];
+    }
+    while (i < numContacts)
+    {
+        merged[k++] = book->contacts[i++];
+    }
+
+    free(book->contacts);
+    book->contacts = merged;
+    book->count = k;
+    contactsMoved(book, numIncoming);
+    book->capacity = numContacts + numIncoming;
+
+    /*
+    replaying the incoming contacts as positional inserts in ascending final position
+    rebuilds the same array
+    */
+    for (j = 0, k = 0; j < numIncoming && book->journal != NULL; k++)
+    {
+        if (book->contacts[k] == incoming[j])
+        {
+            journalInsert(book, k, incoming[j]);
+            j++;
+        }
+    }
+    return true;
+}
+
+/*
+Stable counting sort on age. Ages are bounded so this is a single O(n + range) pass.
+*/
+bool countingSortByAge(Contact** items, Contact** scratch, int count, bool descending)
+{
+    int minAge = 0;
+    int maxAge = 0;
+    int range = 0;
+    int* starts = NULL;
+    int total = 0;
+    int bucket = 0;
+
+    if (count < 2)
+    {
+        return true;
+    }
+    minAge = items[0]->age;
+    maxAge = items[0]->age;
+    for (int i = 1; i < count; i++)
+    {
+        if (items[i]->age < minAge)
+        {
+            minAge = items[i]->age;
+        }
+        if (items[i]->age > maxAge)
+        {
+            maxAge = items[i]->age;
+        }
+    }
+    range = maxAge - minAge + 1;
+
+    starts = (int*)allocateZeroed(range, sizeof(int));
+    if (starts == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation error in countingSortByAge");
+        return false;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        starts[items[i]->age - minAge] += 1;
+    }
+    for (int b = 0; b < range; b++)
+    {
+        bucket = descending ? range - 1 - b : b;
+        total += starts[bucket];
+        starts[bucket] = total - starts[bucket];
+    }
+    for (int i = 0; i < count; i++)
+    {
+        scratch[starts[items[i]->age - minAge]++] = items[i];
+    }
+    memcpy(items, scratch, count * sizeof(Contact*));
+    free(starts);
+    return true;
+}
+
+/*
+Stable LSD radix sort on the phone number, 12 bits per pass. Phone numbers fit in
+34 bits so three passes cover them; passes above the largest key are skipped.
+Descending order sorts on (max - phone), which keeps equal keys in their order.
+*/
+bool radixSortByPhone(Contact** items, Contact** scratch, int count, bool descending)
+{
+    const int RADIX_BITS = 12;
+    const int RADIX_SIZE = 1 << 12;
+    long long maxPhone = 0;
+    long long minPhone = 0;
+    long long key = 0;
+    int* starts = NULL;
+    int total = 0;
+    Contact** source = items;
+    Contact** target = scratch;
+    Contact** swap = NULL;
+
+    if (count < 2)
+    {
+        return true;
+    }
+    minPhone = items[0]->phonNum;
+    maxPhone = items[0]->phonNum;
+    for (int i = 1; i < count; i++)
+    {
+        if (items[i]->phonNum < minPhone)
+        {
+            minPhone = items[i]->phonNum;
+        }
+        if (items[i]->phonNum > maxPhone)
+        {
+            maxPhone = items[i]->phonNum;
+        }
+    }
+
+    starts = (int*)allocate(RADIX_SIZE * sizeof(int));
+    if (starts == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation error in radixSortByPhone");
+        return false;
+    }
+
+    /*keys are taken relative to minPhone (or maxPhone when descending) so they are never negative*/
+    for (int shift = 0; shift < 64 && ((unsigned long long)(maxPhone - minPhone) >> shift) != 0; shift += RADIX_BITS)
+    {
+        memset(starts, 0, RADIX_SIZE * sizeof(int));
+        for (int i = 0; i < count; i++)
+        {
+            key = descending ? maxPhone - source[i]->phonNum : source[i]->phonNum - minPhone;
+            starts[((unsigned long long)key >> shift) & (RADIX_SIZE - 1)] += 1;
+        }
+        total = 0;
+        for (int b = 0; b < RADIX_SIZE; b++)
+        {
+            total += starts[b];
+            starts[b] = total - starts[b];
+        }
+        for (int i = 0; i < count; i++)
+        {
+            key = descending ? maxPhone - source[i]->phonNum : source[i]->phonNum - minPhone;
+            target[starts[((unsigned long long)key >> shift) & (RADIX_SIZE - 1)]++] = source[i];
+        }
+        swap = source;
+        source = target;
+        target = swap;
+    }
+
+    if (source != items)
+    {
+        memcpy(items, source, count * sizeof(Contact*));
+    }
+    free(starts);
+    return true;
+}
+
+/*
+Stable sort of the whole book. Names and addresses use the merge sort, the bounded
+numeric fields use counting and radix sorts.
+*/
+bool sortContacts(AddressBook* book, int key, int order)
+{
+    bool descending = order == SORT_DESCENDING;
+
+    settleRemovals(book);
+    if (key < SORT_BY_NAME || key > SORT_BY_ADDRESS)
+    {
+        fprintf(stderr, "Error: Unknown sort key in sortContacts");
+        return false;
+    }
+    if (key == SORT_BY_ADDRESS && !resolveAddresses(book))
+    {
+        return false;
+    }
+    if (!sortContactArray(book->contacts, book->count, key, descending))
+    {
+        return false;
+    }
+    book->version += 1;
+    contactsMoved(book, book->count);
+    journalSort(book, key, order);
+    return true;
+}
+
+/*
+The sort behind sortContacts, also used on the pointer copies of listContactsPage.
+*/
+bool sortContactArray(Contact** items, int count, int key, bool descending)
+{
+    Contact** scratch = NULL;
+    bool sorted = false;
+
+    if (count < 2)
+    {
+        return true;
+    }
+
+    switch (key)
+    {
+        case SORT_BY_NAME:
+            return mergeSortContacts(items, count, compareContactNames, familyNamePrefix, descending);
+        case SORT_BY_ADDRESS:
+            return mergeSortContacts(items, count, compareContactAddresses, addressPrefix, descending);
+        case SORT_BY_AGE:
+        case SORT_BY_PHONE:
+            scratch = (Contact**)allocate(count * sizeof(Contact*));
+            if (scratch == NULL)
+            {
+                fprintf(stderr, "Error: Memory allocation error in sortContactArray");
+                return false;
+            }
+            if (key == SORT_BY_AGE)
+            {
+                sorted = countingSortByAge(items, scratch, count, descending);
+            }
+            else
+            {
+                sorted = radixSortByPhone(items, scratch, count, descending);
+            }
+            free(scratch);
+            return sorted;
+        default:
+            fprintf(stderr, "Error: Unknown sort key in sortContacts");
+            return false;
+    }
+}
+
+void sortContactsInteractive(AddressBook* book)
+{
+    int key = 0;
+    int order = 0;
+
+    printf("Sort by (1. Name 2. Age 3. Phone Number 4. Address): ");
+    if (scanf("%d", &key) != 1 || key < SORT_BY_NAME || key > SORT_BY_ADDRESS)
+    {
+        fprintf(stderr, "Error: Invalid sort key");
+        return;
+    }
+    printf("Order (1. Ascending 2. Descending): ");
+    if (scanf("%d", &order) != 1 || (order != SORT_ASCENDING && order != SORT_DESCENDING))
+    {
+        fprintf(stderr, "Error: Invalid sort order");
+        return;
+    }
+    if (sortContacts(book, key, order))
+    {
+        report("Contacts sorted successfully.\n");
+    }
+}
+
+/*
+Records accepted by a merge, collected until the whole file has been read.
+*/
+typedef struct PendingMerge {
+    Contact** incoming;
+    int numIncoming;
+} PendingMerge;
+
+/*
+Drops the records collected by a merge that could not be completed.
+*/
+void abandonMerge(AddressBook* book, Contact** incoming, int numIncoming)
+{
+    for (int i = 0; i < numIncoming; i++)
+    {
+        unindexContact(book, incoming[i]);
+    }
+    free(incoming);
+}
+
+bool beginMerge(AddressBook* book, int numContacts, void* context)
+{
+    PendingMerge* pending = (PendingMerge*)context;
+
+    if (numContacts > 0)
+    {
+        pending->incoming = (Contact**)allocate(numContacts * sizeof(Contact*));
+        if (pending->incoming == NULL || !ensureNameIndex(book) || !reserveNameIndex(&book->names, book->names.count + numContacts))
+        {
+            fprintf(stderr, "Error: Memory allocation error in mergeContactsFromFile");
+            return false;
+        }
+    }
+    return true;
+}
+
+int acceptMerge(AddressBook* book, Contact* c, void* context)
+{
+    PendingMerge* pending = (PendingMerge*)context;
+
+    /*check to see if this name is already in the book*/
+    if (nameInBook(c->firstName, c->familyName, book))
+    {
+        report("Duplicate Contact detected\n");
+        return SINK_REJECTED;
+    }
+
+    /*
+    indexing the accepted record right away makes later copies of the
+    same name in this file duplicates, exactly as one-at-a-time insertion did
+    */
+    if (!indexContact(book, c, -1))
+    {
+        return SINK_FAILED;
+    }
+    pending->incoming[pending->numIncoming] = c;
+    pending->numIncoming += 1;
+    report("Contact added in alphabetical order successfully.\n");
+    return SINK_ACCEPTED;
+}
+
+bool mergeContactsFromFile(AddressBook* book, char* filename)
+{
+    unsigned long long start = statStart();
+    PendingMerge pending = {NULL, 0};
+    ContactSink sink = {beginMerge, acceptMerge, &pending};
+
+    if (!readContactsFromFile(book, filename, &sink) || !mergeSortedContacts(book, pending.incoming, pending.numIncoming))
+    {
+        abandonMerge(book, pending.incoming, pending.numIncoming);
+        statStop(STAT_MERGE_FILE, start);
+        return false;
+    }
+    free(pending.incoming);
+    report("Appended contacts from %s\n", filename);
+    statStop(STAT_MERGE_FILE, start);
+    return true;
+}
+
+#define MAX_MERGE_FILES 64
+
+/*
+One input of mergeContactFiles, in name order, and the position of its next contact.
+*/
+typedef struct MergeRun {
+    Contact** contacts;
+    int count;
+    int next;
+} MergeRun;
+
+/*
+Heap entry of mergeContactFiles: the next contact of a run and its family name prefix.
+*/
+typedef struct MergeHead {
+    unsigned long long prefix;
+    Contact* contact;
+    int run;
+} MergeHead;
+
+bool contactsInNameOrder(Contact** items, int count)
+{
+    for (int i = 1; i < count; i++)
+    {
+        if (compareContactNames(items[i - 1], items[i]) > 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+Runs with equal names come out in file order, though merging drops duplicates first.
+*/
+int compareMergeHeads(const MergeHead* a, const MergeHead* b)
+{
+    int result = 0;
+
+    if (a->prefix != b->prefix)
+    {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+    result = compareContactNames(a->contact, b->contact);
+    if (result == 0)
+    {
+        result = a->run - b->run;
+    }
+    return result;
+}
+
+void siftDownMergeHeap(MergeHead* heap, int count, int i)
+{
+    MergeHead top = heap[i];
+    int child = 2 * i + 1;
+
+    while (child < count)
+    {
+        if (child + 1 < count && compareMergeHeads(&heap[child + 1], &heap[child]) < 0)
+        {
+            child += 1;
+        }
+        if (compareMergeHeads(&heap[child], &top) >= 0)
+        {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+        child = 2 * i + 1;
+    }
+    heap[i] = top;
+}
+
+/*
+Heap based K-way merge of the runs into merged, O(total log K) comparisons.
+*/
+void mergeRuns(MergeRun runs[], int numRuns, Contact** merged)
+{
+    MergeHead heap[MAX_MERGE_FILES];
+    MergeRun* run = NULL;
+    int heapSize = 0;
+    int k = 0;
+
+    for (int r = 0; r < numRuns; r++)
+    {
+        runs[r].next = 0;
+        if (runs[r].count > 0)
+        {
+            heap[heapSize].contact = runs[r].contacts[runs[r].next++];
+            heap[heapSize].prefix = familyNamePrefix(heap[heapSize].contact);
+            heap[heapSize].run = r;
+            heapSize += 1;
+        }
+    }
+    for (int i = heapSize / 2 - 1; i >= 0; i--)
+    {
+        siftDownMergeHeap(heap, heapSize, i);
+    }
+
+    while (heapSize > 0)
+    {
+        merged[k++] = heap[0].contact;
+        run = &runs[heap[0].run];
+        if (run->next < run->count)
+        {
+            heap[0].contact = run->contacts[run->next++];
+            heap[0].prefix = familyNamePrefix(heap[0].contact);
+        }
+        else
+        {
+            heap[0] = heap[--heapSize];
+        }
+        siftDownMergeHeap(heap, heapSize, 0);
+    }
+}
+
+/*
+Merges several files into the book in one pass instead of one mergeContactsFromFile
+per file. Each file is read through the merge sink, which drops names already in
+the book or in an earlier file, and sorted unless it already is in name order. The
+sorted runs are then combined by mergeRuns and spliced into the book once. Nothing
+is merged unless every file could be read.
+*/
+bool mergeContactFiles(AddressBook* book, char* filenames[], int numFiles)
+{
+    unsigned long long start = statStart();
+    MergeRun runs[MAX_MERGE_FILES];
+    PendingMerge pending = {NULL, 0};
+    ContactSink sink = {beginMerge, acceptMerge, &pending};
+    Contact** merged = NULL;
+    int numRead = 0;
+    int total = 0;
+    bool ok = true;
+
+    if (numFiles > MAX_MERGE_FILES)
+    {
+        fprintf(stderr, "Error: at most %d files can be merged at once\n", MAX_MERGE_FILES);
+        statStop(STAT_MERGE_FILES, start);
+        return false;
+    }
+
+    for (; numRead < numFiles && ok; numRead++)
+    {
+        pending.incoming = NULL;
+        pending.numIncoming = 0;
+        ok = readContactsFromFile(book, filenames[numRead], &sink);
+        runs[numRead].contacts = pending.incoming;
+        runs[numRead].count = pending.numIncoming;
+        total += pending.numIncoming;
+        if (ok && !contactsInNameOrder(pending.incoming, pending.numIncoming))
+        {
+            ok = mergeSortContacts(pending.incoming, pending.numIncoming, compareContactNames, familyNamePrefix, false);
+        }
+    }
+
+    if (ok && total > 0)
+    {
+        merged = (Contact**)allocate(total * sizeof(Contact*));
+        if (merged == NULL)
+        {
+            fprintf(stderr, "Error: Memory allocation error in mergeContactFiles");
+            ok = false;
+        }
+        else
+        {
+            mergeRuns(runs, numRead, merged);
+            ok = spliceSortedContacts(book, merged, total);
+        }
+    }
+
+    for (int r = 0; r < numRead; r++)
+    {
+        if (ok)
+        {
+            free(runs[r].contacts);
+        }
+        else
+        {
+            abandonMerge(book, runs[r].contacts, runs[r].count);
+        }
+    }
+    free(merged);
+    if (ok)
+    {
+        report("Merged %d contacts from %d files\n", total, numFiles);
+    }
+    statStop(STAT_MERGE_FILES, start);
+    return ok;
+}
+
+/*
+mergeContactFiles into a new book that is saved to outputFilename, leaving the
+current book alone.
+*/
+bool mergeContactFilesTo(char* outputFilename, char* filenames[], int numFiles)
+{
+    AddressBook* merged = createAddressBook();
+    bool ok = false;
+
+    if (merged == NULL)
+    {
+        return false;
+    }
+    ok = mergeContactFiles(merged, filenames, numFiles) && saveContactsToFile(merged, outputFilename);
+    freeAddressBook(merged);
+    return ok;
+}
+
+void mergeContactFilesInteractive(AddressBook* book)
+{
+    char names[MAX_MERGE_FILES][100];
+    char* filenames[MAX_MERGE_FILES];
+    int numFiles = 0;
+
+    printf("Number of files to merge (at most %d): ", MAX_MERGE_FILES);
+    if (scanf("%d", &numFiles) != 1 || numFiles < 1 || numFiles > MAX_MERGE_FILES)
+    {
+        fprintf(stderr, "Error: Invalid number of files");
+        return;
+    }
+    for (int i = 0; i < numFiles; i++)
+    {
+        printf("Enter filename %d to merge: ", i + 1);
+        if (scanf("%99s", names[i]) != 1)
+        {
+            return;
+        }
+        filenames[i] = names[i];
+    }
+    mergeContactFiles(book, filenames, numFiles);
+}
+
+void printEditMenu()
+{
+    printf("1. Edit First Name\n");
+    printf("2. Edit Last Name\n");
+    printf("3. Edit Address\n");
+    printf("4. Edit Phone Number\n");
+    printf("5. Edit Age\n");
+    printf("6. Cancel\n");
+    printf("Choose an option: ");
+}
+
+/*
+Applies an already validated edit to the contact at slot index. Shared by editContact and
+journal replay.
+*/
+bool applyContactEdit(AddressBook* book, int index, int field, const char* value)
+{
+    Contact* selectedContact = book->contacts[index];
+    char** target = NULL;
+    unsigned char ownFlag = 0;
+
+    switch (field)
+    {
+        case EDIT_FIRST:
+        case EDIT_LAST:
+            target = field == EDIT_FIRST ? &selectedContact->firstName : &selectedContact->familyName;
+            ownFlag = field == EDIT_FIRST ? OWNS_FIRST_NAME : OWNS_FAMILY_NAME;
+            unindexContact(book, selectedContact);
+            if (!setContactString(book, selectedContact, target, ownFlag, value))
+            {
+                indexContact(book, selectedContact, index);
+                return false;
+            }
+            if (!indexContact(book, selectedContact, index))
+            {
+                return false;
+            }
+            break;
+        case EDIT_ADDR:
+            if (!setContactString(book, selectedContact, &selectedContact->address, OWNS_ADDRESS, value))
+            {
+                return false;
+            }
+            book->version += 1;
+            break;
+        case EDIT_PHN:
+            unindexContact(book, selectedContact);
+            selectedContact->phonNum = atoll(value);
+            if (!indexContact(book, selectedContact, index))
+            {
+                return false;
+            }
+            break;
+        case EDIT_AGE:
+            selectedContact->age = atoi(value);
+            book->version += 1;
+            break;
+        default:
+            return false;
+    }
+    journalEdit(book, contactRank(book, index), field, value);
+    return true;
+}
+
+bool editContact(AddressBook* book)
+{
+    int numContacts = liveContacts(book);
+    int index = 0;
+    char prompt[64] = {"\0"};
+
+    if (numContacts == 0)
+    {
+        printf("No contacts available to edit.\n");
+        return false;
+    }
+
+    snprintf(prompt, sizeof(prompt), "Enter index of contact to edit (0-%d): ", numContacts-1);
+    if (!readContactIndex(book, prompt, &index) || !(0 <= index && index <= numContacts-1))
+    {
+        fprintf(stderr, "Error: Invalid Index");
+        return false;
+    }
+
+    return editContactAt(book, contactSlot(book, index));
+}
+
+/*
+Asks which field of the contact at index to change and applies it.
+*/
+bool editContactAt(AddressBook* book, int index)
+{
+    Contact* selectedContact = book->contacts[index];
+    int option = 0;
     char scanBuffer[100] = {"\0"};
-    int numContacts = 0;
-    char* myFirstName = NULL;
-    char* myFamilyName = NULL;
-    char* myAddress = NULL;
-    long long myPhoneNumber = 0;
     int myAge = 0;
     const int MAX_AGE = 150;
     const int MIN_AGE = 1;
 
-    inputStream = fopen(filename, "r");
-    if (inputStream == NULL)
+    printf("Editing contact: %s %s\n", selectedContact->firstName, selectedContact->familyName);
+
+    printEditMenu();
+    scanf("%d", &option);
+
+    switch(option)
+    {
+        case EDIT_FIRST:
+            printf("Enter new first name: ");
+            scanf("%s", scanBuffer);
+            break;
+        case EDIT_LAST:
+            printf("Enter new family name: ");
+            scanf("%s", scanBuffer);
+            break;
+        case EDIT_ADDR:
+            printf("Enter new address: ");
+            fscanf(stdin, " %99[^\n]", scanBuffer);
+            break;
+        case EDIT_PHN:
+            printf("Enter new phone number: Enter 10-digit phone number that must not start with 0: ");
+            fscanf(stdin, " %99[^\n]", scanBuffer);
+            if (!(validPhoneNumber(scanBuffer)))
+            {
+                fprintf(stderr, "Error: Invalid phone number.\n");
+                return false;
+            }
+            break;
+        case EDIT_AGE:
+            printf("Enter new age: ");
+            fscanf(stdin, "%d", &myAge);
+            if (!(myAge >= MIN_AGE && myAge <= MAX_AGE))
+            {
+                fprintf(stderr, "Error: Invalid age.");
+                return false;
+            }
+            snprintf(scanBuffer, sizeof(scanBuffer), "%d", myAge);
+            break;
+        case CANCEL:
+            printf("Edit cancelled.\n");
+            return true;
+        default:
+            printf("Contact updated successfully.\n");
+            return true;
+    }
+    if (!applyContactEdit(book, index, option, scanBuffer))
+    {
+        return false;
+    }
+    printf("Contact updated successfully.\n");
+    return true;
+}
+
+/*
+Reads a phone number for a lookup, 0 if it is not a valid one.
+*/
+long long readPhoneNumber()
+{
+    char buffer[100] = {"\0"};
+
+    printf("Enter phone number: ");
+    if (scanf("%99s", buffer) != 1 || !validPhoneNumber(buffer))
+    {
+        fprintf(stderr, "Error: Invalid phone number.\n");
+        return 0;
+    }
+    return atoll(buffer);
+}
+
+void printContact(AddressBook* book, Contact* c)
+{
+    size_t addressLength = 0;
+    const char* address = contactAddress(book, c, &addressLength);
+
+    printf("%s %s\n", c->firstName, c->familyName);
+    printf("   Phone: %lld\n", c->phonNum);
+    printf("   Address: %.*s\n", (int)addressLength, address);
+    printf("   Age: %d\n", c->age);
+}
+
+bool printContactsWithPhone(AddressBook* book, long long phonNum)
+{
+    const int MAX_SHOWN = 16;
+    Contact* matches[16];
+    int found = findContactsByPhone(book, phonNum, matches, MAX_SHOWN);
+
+    if (found == 0)
+    {
+        printf("No Contact with phone number %lld found\n", phonNum);
+        return false;
+    }
+    for (int i = 0; i < found && i < MAX_SHOWN; i++)
+    {
+        printContact(book, matches[i]);
+    }
+    if (found > MAX_SHOWN)
+    {
+        printf("... and %d more\n", found - MAX_SHOWN);
+    }
+    return true;
+}
+
+bool findContactByPhoneInteractive(AddressBook* book)
+{
+    long long phonNum = readPhoneNumber();
+
+    return phonNum != 0 && printContactsWithPhone(book, phonNum);
+}
+
+bool removeContactByPhone(AddressBook* book, long long phonNum)
+{
+    int index = findUniqueContactByPhone(book, phonNum);
+
+    if (index < 0)
+    {
+        return false;
+    }
+    removeContactAt(book, index);
+    report("Contact removed successfully.\n");
+    return true;
+}
+
+bool removeContactByPhoneInteractive(AddressBook* book)
+{
+    long long phonNum = readPhoneNumber();
+
+    return phonNum != 0 && removeContactByPhone(book, phonNum);
+}
+
+bool editContactByPhone(AddressBook* book)
+{
+    long long phonNum = readPhoneNumber();
+    int index = phonNum == 0 ? -1 : findUniqueContactByPhone(book, phonNum);
+
+    if (index < 0)
+    {
+        return false;
+    }
+    return editContactAt(book, index);
+}
+
+unsigned long long foldedPrefix(const char* text)
+{
+    unsigned long long prefix = 0;
+    int i = 0;
+
+    for (; i < 8 && text[i] != '\0'; i++)
+    {
+        prefix = (prefix << 8) | (unsigned char)tolower((unsigned char)text[i]);
+    }
+    return prefix << (8 * (8 - i));
+}
+
+/*
+Fills both key words from the start of name, the second one only when the first
+is full.
+*/
+void setPrefixEntry(PrefixEntry* entry, const char* name, int position)
+{
+    entry->key = foldedPrefix(name);
+    entry->keyRest = (entry->key & 0xFF) == 0 ? 0 : foldedPrefix(name + 8);
+    entry->position = position;
+}
+
+const char* prefixEntryName(AddressBook* book, const PrefixEntry* entry, bool byFirstName)
+{
+    Contact* c = book->contacts[entry->position];
+
+    return byFirstName ? c->firstName : c->familyName;
+}
+
+int comparePrefixEntries(AddressBook* book, const PrefixEntry* a, const PrefixEntry* b, bool byFirstName)
+{
+    if (a->key != b->key)
+    {
+        return a->key < b->key ? -1 : 1;
+    }
+    if (a->keyRest != b->keyRest)
+    {
+        return a->keyRest < b->keyRest ? -1 : 1;
+    }
+    /*a zero last byte means the keys already hold both names in full*/
+    if ((a->key & 0xFF) == 0 || (a->keyRest & 0xFF) == 0)
+    {
+        return 0;
+    }
+    statistics.stringComparisons += 1;
+    return strcasecmp(prefixEntryName(book, a, byFirstName), prefixEntryName(book, b, byFirstName));
+}
+
+/*
+Stable bottom-up merge sort, equal names keep their book order.
+*/
+void sortPrefixEntries(AddressBook* book, PrefixEntry* entries, PrefixEntry* scratch, int count, bool byFirstName)
+{
+    PrefixEntry* from = entries;
+    PrefixEntry* to = scratch;
+    PrefixEntry* swap = NULL;
+    int left = 0;
+    int right = 0;
+    int leftEnd = 0;
+    int rightEnd = 0;
+    int out = 0;
+
+    for (int width = 1; width < count; width *= 2)
+    {
+        for (int start = 0; start < count; start += 2 * width)
+        {
+            left = start;
+            leftEnd = start + width < count ? start + width : count;
+            right = leftEnd;
+            rightEnd = start + 2 * width < count ? start + 2 * width : count;
+            out = start;
+            while (left < leftEnd && right < rightEnd)
+            {
+                if (comparePrefixEntries(book, &from[right], &from[left], byFirstName) < 0)
+                {
+                    to[out++] = from[right++];
+                }
+                else
+                {
+                    to[out++] = from[left++];
+                }
+            }
+            while (left < leftEnd)
+            {
+                to[out++] = from[left++];
+            }
+            while (right < rightEnd)
+            {
+                to[out++] = from[right++];
+            }
+        }
+        swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != entries)
+    {
+        memcpy(entries, from, count * sizeof(PrefixEntry));
+    }
+}
+
+void freePrefixIndex(PrefixIndex* index)
+{
+    free(index->byFamilyName);
+    free(index->byFirstName);
+    index->byFamilyName = NULL;
+    index->byFirstName = NULL;
+    index->count = 0;
+}
+
+/*
+Rebuilds the prefix index if the book changed since it was built. Searching right
+after a change costs one O(n log n) rebuild, searches in between are O(log n + k).
+*/
+bool ensurePrefixIndex(AddressBook* book)
+{
+    PrefixIndex* index = &book->prefixes;
+    PrefixEntry* scratch = NULL;
+
+    settleRemovals(book);
+    if (index->byFamilyName != NULL && index->builtVersion == book->version)
+    {
+        return true;
+    }
+    freePrefixIndex(index);
+    index->byFamilyName = (PrefixEntry*)allocate((book->count + 1) * sizeof(PrefixEntry));
+    index->byFirstName = (PrefixEntry*)allocate((book->count + 1) * sizeof(PrefixEntry));
+    scratch = (PrefixEntry*)allocate((book->count + 1) * sizeof(PrefixEntry));
+    if (index->byFamilyName == NULL || index->byFirstName == NULL || scratch == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in ensurePrefixIndex");
+        free(scratch);
+        freePrefixIndex(index);
+        return false;
+    }
+    for (int i = 0; i < book->count; i++)
+    {
+        setPrefixEntry(&index->byFamilyName[i], book->contacts[i]->familyName, i);
+        setPrefixEntry(&index->byFirstName[i], book->contacts[i]->firstName, i);
+    }
+    sortPrefixEntries(book, index->byFamilyName, scratch, book->count, false);
+    sortPrefixEntries(book, index->byFirstName, scratch, book->count, true);
+    free(scratch);
+    index->count = book->count;
+    index->builtVersion = book->version;
+    return true;
+}
+
+/*
+First entry whose name does not sort before prefix, the start of the run of names
+beginning with it.
+*/
+int prefixRunStart(AddressBook* book, PrefixEntry* entries, const char* prefix, bool byFirstName)
+{
+    size_t length = strlen(prefix);
+    int low = 0;
+    int high = book->prefixes.count;
+    int middle = 0;
+
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        if (strncasecmp(prefixEntryName(book, &entries[middle], byFirstName), prefix, length) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/*
+Finds the contacts whose family or first name starts with prefix, ignoring case.
+Family name matches come first, in family name order, then the remaining first
+name matches. Stores up to maxPositions positions and returns the number of matches.
+*/
+int searchContactsByPrefix(AddressBook* book, const char* prefix, int positions[], int maxPositions)
+{
+    PrefixIndex* index = &book->prefixes;
+    size_t length = strlen(prefix);
+    int found = 0;
+    Contact* c = NULL;
+
+    if (!ensurePrefixIndex(book))
+    {
+        return 0;
+    }
+    for (int i = prefixRunStart(book, index->byFamilyName, prefix, false); i < index->count; i++)
+    {
+        if (strncasecmp(prefixEntryName(book, &index->byFamilyName[i], false), prefix, length) != 0)
+        {
+            break;
+        }
+        if (found < maxPositions)
+        {
+            positions[found] = index->byFamilyName[i].position;
+        }
+        found += 1;
+    }
+    for (int i = prefixRunStart(book, index->byFirstName, prefix, true); i < index->count; i++)
+    {
+        c = book->contacts[index->byFirstName[i].position];
+        if (strncasecmp(c->firstName, prefix, length) != 0)
+        {
+            break;
+        }
+        /*already listed through its family name*/
+        if (strncasecmp(c->familyName, prefix, length) == 0)
+        {
+            continue;
+        }
+        if (found < maxPositions)
+        {
+            positions[found] = index->byFirstName[i].position;
+        }
+        found += 1;
+    }
+    return found;
+}
+
+/*
+Lists the first matches with the index editContact and the remove options take.
+*/
+int printPrefixMatches(AddressBook* book, const char* prefix)
+{
+    const int MAX_SHOWN = 20;
+    int positions[20];
+    int found = searchContactsByPrefix(book, prefix, positions, MAX_SHOWN);
+    Contact* c = NULL;
+
+    if (found == 0)
+    {
+        printf("No contacts match '%s'.\n", prefix);
+        return 0;
+    }
+    for (int i = 0; i < found && i < MAX_SHOWN; i++)
+    {
+        c = book->contacts[positions[i]];
+        printf("Index %d: %s %s, %lld\n", positions[i], c->firstName, c->familyName, c->phonNum);
+    }
+    if (found > MAX_SHOWN)
+    {
+        printf("... and %d more\n", found - MAX_SHOWN);
+    }
+    return found;
+}
+
+bool searchContactsInteractive(AddressBook* book)
+{
+    char prefix[100] = {"\0"};
+
+    printf("Enter the start of a first or family name: ");
+    if (scanf("%99s", prefix) != 1)
+    {
+        return false;
+    }
+    return printPrefixMatches(book, prefix) > 0;
+}
+
+/*
+Reads a contact index after prompt. Typing ?prefix instead lists the contacts whose
+name starts with prefix, with their indexes, and asks again.
+*/
+bool readContactIndex(AddressBook* book, const char* prompt, int* index)
+{
+    char prefix[100] = {"\0"};
+    int next = 0;
+
+    while (true)
+    {
+        printf("%s", prompt);
+        scanf(" ");
+        next = getchar();
+        if (next != '?')
+        {
+            if (next != EOF)
+            {
+                ungetc(next, stdin);
+            }
+            return scanf("%d", index) == 1;
+        }
+        prefix[0] = '\0';
+        scanf("%99[^\n]", prefix);
+        printPrefixMatches(book, prefix);
+    }
+}
+
+/*
+Hashed trigrams of every space separated word of text, lowercased. A word of length
+L gives L + 2 trigrams, and one edit inside it changes at most 3 of them.
+*/
+int textTrigrams(const char* text, unsigned int buckets[], int maxTrigrams)
+{
+    int count = 0;
+    unsigned int window = 0;
+
+    while (*text != '\0' && count < maxTrigrams)
+    {
+        while (*text == ' ')
+        {
+            text++;
+        }
+        if (*text == '\0')
+        {
+            break;
+        }
+        window = (' ' << 8) | ' ';
+        /*the two extra steps slide the trailing padding in*/
+        for (int padding = 0; padding < 2 || (*text != '\0' && *text != ' '); )
+        {
+            if (*text != '\0' && *text != ' ')
+            {
+                window = ((window << 8) | (unsigned char)tolower((unsigned char)*text++)) & 0xFFFFFF;
+            }
+            else
+            {
+                window = ((window << 8) | ' ') & 0xFFFFFF;
+                padding++;
+            }
+            if (count < maxTrigrams)
+            {
+                buckets[count++] = (window * 2654435761u) >> (32 - TRIGRAM_BUCKET_BITS);
+            }
+        }
+    }
+    return count;
+}
+
+void freeTrigramIndex(TrigramIndex* index)
+{
+    free(index->bucketStarts);
+    free(index->positions);
+    free(index->seen);
+    free(index->hits);
+    free(index->candidates);
+    index->bucketStarts = NULL;
+    index->positions = NULL;
+    index->seen = NULL;
+    index->hits = NULL;
+    index->candidates = NULL;
+    index->query = 0;
+    index->count = 0;
+}
+
+/*
+Rebuilds the trigram index if the book changed since it was built: one pass counts
+the bucket sizes, a second fills them.
+*/
+bool ensureTrigramIndex(AddressBook* book)
+{
+    TrigramIndex* index = &book->trigrams;
+    unsigned int buckets[2 * MAX_TRIGRAMS];
+    int numTrigrams = 0;
+    size_t total = 0;
+    Contact* c = NULL;
+
+    settleRemovals(book);
+    if (index->bucketStarts != NULL && index->builtVersion == book->version)
+    {
+        return true;
+    }
+    freeTrigramIndex(index);
+    index->bucketStarts = (int*)allocateZeroed(TRIGRAM_BUCKETS + 1, sizeof(int));
+    index->seen = (unsigned int*)allocateZeroed(book->count + 1, sizeof(unsigned int));
+    index->hits = (int*)allocate((book->count + 1) * sizeof(int));
+    index->candidates = (int*)allocate((book->count + 1) * sizeof(int));
+    if (index->bucketStarts == NULL || index->seen == NULL || index->hits == NULL || index->candidates == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in ensureTrigramIndex");
+        freeTrigramIndex(index);
+        return false;
+    }
+
+    for (int i = 0; i < book->count; i++)
+    {
+        c = book->contacts[i];
+        numTrigrams = textTrigrams(c->firstName, buckets, MAX_TRIGRAMS);
+        numTrigrams += textTrigrams(c->familyName, buckets + numTrigrams, MAX_TRIGRAMS);
+        for (int j = 0; j < numTrigrams; j++)
+        {
+            index->bucketStarts[buckets[j] + 1] += 1;
+        }
+        total += numTrigrams;
+    }
+    for (int b = 0; b < TRIGRAM_BUCKETS; b++)
+    {
+        index->bucketStarts[b + 1] += index->bucketStarts[b];
+    }
+
+    index->positions = (int*)allocate((total + 1) * sizeof(int));
+    if (index->positions == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in ensureTrigramIndex");
+        freeTrigramIndex(index);
+        return false;
+    }
+    /*fill each bucket from its end, bucketStarts[b + 1] walks back to the start of bucket b*/
+    for (int i = book->count - 1; i >= 0; i--)
+    {
+        c = book->contacts[i];
+        numTrigrams = textTrigrams(c->firstName, buckets, MAX_TRIGRAMS);
+        numTrigrams += textTrigrams(c->familyName, buckets + numTrigrams, MAX_TRIGRAMS);
+        for (int j = 0; j < numTrigrams; j++)
+        {
+            index->positions[--index->bucketStarts[buckets[j] + 1]] = i;
+        }
+    }
+    for (int b = 0; b < TRIGRAM_BUCKETS; b++)
+    {
+        index->bucketStarts[b] = index->bucketStarts[b + 1];
+    }
+    index->bucketStarts[TRIGRAM_BUCKETS] = (int)total;
+    index->count = book->count;
+    index->builtVersion = book->version;
+    return true;
+}
+
+/*
+Levenshtein distance of a and b ignoring case, or limit + 1 once it is certain to
+exceed limit. Only the diagonal band of width 2 * limit + 1 is computed.
+*/
+int boundedEditDistance(const char* a, const char* b, int limit)
+{
+    int lengthA = (int)strlen(a);
+    int lengthB = (int)strlen(b);
+    int rows[2][201];
+    int* previous = rows[0];
+    int* current = rows[1];
+    int* swap = NULL;
+    int low = 0;
+    int high = 0;
+    int best = 0;
+    int cost = 0;
+
+    if (lengthA > 200 || lengthB > 200 || abs(lengthA - lengthB) > limit)
+    {
+        return limit + 1;
+    }
+    for (int j = 0; j <= lengthB; j++)
+    {
+        previous[j] = j;
+    }
+    for (int i = 1; i <= lengthA; i++)
+    {
+        low = i - limit > 1 ? i - limit : 1;
+        high = i + limit < lengthB ? i + limit : lengthB;
+        current[0] = i;
+        if (low > 1)
+        {
+            current[low - 1] = limit + 1;
+        }
+        best = i <= limit ? i : limit + 1;
+        for (int j = low; j <= high; j++)
+        {
+            cost = tolower((unsigned char)a[i - 1]) != tolower((unsigned char)b[j - 1]);
+            current[j] = previous[j - 1] + cost;
+            if (j < i + limit && previous[j] + 1 < current[j])
+            {
+                current[j] = previous[j] + 1;
+            }
+            if (current[j - 1] + 1 < current[j])
+            {
+                current[j] = current[j - 1] + 1;
+            }
+            if (current[j] < best)
+            {
+                best = current[j];
+            }
+        }
+        if (high < lengthB)
+        {
+            current[high + 1] = limit + 1;
+        }
+        if (best > limit)
+        {
+            return limit + 1;
+        }
+        swap = previous;
+        previous = current;
+        current = swap;
+    }
+    return previous[lengthB] <= limit ? previous[lengthB] : limit + 1;
+}
+
+/*
+Edits allowed for a query: one up to 4 characters, two beyond.
+*/
+int fuzzyLimit(size_t length)
+{
+    return length <= 4 ? 1 : 2;
+}
+
+/*
+Binary search of one bucket, its positions are in increasing order.
+*/
+bool trigramListContains(TrigramIndex* index, unsigned int bucket, int position)
+{
+    int low = index->bucketStarts[bucket];
+    int high = index->bucketStarts[bucket + 1];
+    int middle = 0;
+
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        if (index->positions[middle] < position)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low < index->bucketStarts[bucket + 1] && index->positions[low] == position;
+}
+
+/*
+A query with a space is matched against "first family", otherwise against the
+closer of the two names.
+*/
+int contactDistance(Contact* c, const char* query, int limit)
+{
+    char fullName[202] = {"\0"};
+    int distance = 0;
+    int other = 0;
+
+    if (strchr(query, ' ') != NULL)
+    {
+        snprintf(fullName, sizeof(fullName), "%s %s", c->firstName, c->familyName);
+        return boundedEditDistance(query, fullName, limit);
+    }
+    distance = boundedEditDistance(query, c->familyName, limit);
+    if (distance > 0)
+    {
+        other = boundedEditDistance(query, c->firstName, distance < limit ? distance : limit);
+        distance = other < distance ? other : distance;
+    }
+    return distance;
+}
+
+int compareFuzzyMatches(AddressBook* book, const FuzzyMatch* a, const FuzzyMatch* b)
+{
+    if (a->distance != b->distance)
+    {
+        return a->distance - b->distance;
+    }
+    return compareContactNames(book->contacts[a->position], book->contacts[b->position]);
+}
+
+/*
+Finds the contacts within fuzzyLimit edits of query, closest first. Each edit
+changes at most 3 trigrams, so a match shares at least required = G - 3 * limit of
+the query's G distinct trigrams and must appear in one of its 3 * limit + 1 shortest
+lists. Only those lists are read; each contact in them is then looked up in the
+longer lists until it is certain to reach or miss required, and the survivors are
+checked with boundedEditDistance. When the query is too short for the bound every
+contact is checked. Stores up to maxMatches results and returns the number of
+contacts that matched.
+*/
+int fuzzySearchContacts(AddressBook* book, const char* query, FuzzyMatch matches[], int maxMatches)
+{
+    TrigramIndex* index = &book->trigrams;
+    unsigned int buckets[MAX_TRIGRAMS];
+    int numTrigrams = textTrigrams(query, buckets, MAX_TRIGRAMS);
+    int limit = fuzzyLimit(strlen(query));
+    int lengths[MAX_TRIGRAMS];
+    unsigned int bucket = 0;
+    int length = 0;
+    int numDistinct = 0;
+    int required = 0;
+    int listsToRead = 0;
+    int numCandidates = 0;
+    int position = 0;
+    int shared = 0;
+    int found = 0;
+    int kept = 0;
+    int j = 0;
+
+    if (numTrigrams == 0 || !ensureTrigramIndex(book))
+    {
+        return 0;
+    }
+
+    /*order the query's distinct trigram lists shortest first*/
+    for (int i = 0; i < numTrigrams; i++)
+    {
+        bucket = buckets[i];
+        length = index->bucketStarts[bucket + 1] - index->bucketStarts[bucket];
+        j = 0;
+        while (j < numDistinct && buckets[j] != bucket)
+        {
+            j++;
+        }
+        if (j < numDistinct)
+        {
+            continue;
+        }
+        for (j = numDistinct; j > 0 && lengths[j - 1] > length; j--)
+        {
+            buckets[j] = buckets[j - 1];
+            lengths[j] = lengths[j - 1];
+        }
+        buckets[j] = bucket;
+        lengths[j] = length;
+        numDistinct += 1;
+    }
+
+    required = numDistinct - 3 * limit;
+    if (required <= 0)
+    {
+        /*too few trigrams to filter on, check every contact*/
+        for (position = 0; position < index->count; position++)
+        {
+            found += considerFuzzyMatch(book, query, limit, position, matches, maxMatches, &kept);
+        }
+        return found;
+    }
+
+    index->query += 1;
+    if (index->query == 0)
+    {
+        memset(index->seen, 0, (index->count + 1) * sizeof(unsigned int));
+        index->query = 1;
+    }
+    listsToRead = numDistinct - required + 1;
+    for (int i = 0; i < listsToRead; i++)
+    {
+        for (int k = index->bucketStarts[buckets[i]]; k < index->bucketStarts[buckets[i] + 1]; k++)
+        {
+            position = index->positions[k];
+            if (index->seen[position] != index->query)
+            {
+                index->seen[position] = index->query;
+                index->hits[position] = 0;
+                index->candidates[numCandidates++] = position;
+            }
+            index->hits[position] += 1;
+        }
+    }
+
+    for (int c = 0; c < numCandidates; c++)
+    {
+        position = index->candidates[c];
+        shared = index->hits[position];
+        for (int i = listsToRead; i < numDistinct && shared < required && shared + numDistinct - i >= required; i++)
+        {
+            if (trigramListContains(index, buckets[i], position))
+            {
+                shared += 1;
+            }
+        }
+        if (shared >= required)
+        {
+            found += considerFuzzyMatch(book, query, limit, position, matches, maxMatches, &kept);
+        }
+    }
+    return found;
+}
+
+/*
+Files the contact at position among the kept best matches if it is within limit.
+Returns 1 for a match, 0 otherwise.
+*/
+int considerFuzzyMatch(AddressBook* book, const char* query, int limit, int position, FuzzyMatch matches[], int maxMatches, int* kept)
+{
+    FuzzyMatch match;
+    int j = 0;
+
+    match.position = position;
+    match.distance = contactDistance(book->contacts[position], query, limit);
+    if (match.distance > limit)
+    {
+        return 0;
+    }
+    j = *kept < maxMatches ? (*kept)++ : maxMatches;
+    for (; j > 0 && compareFuzzyMatches(book, &match, &matches[j - 1]) < 0; j--)
+    {
+        if (j < maxMatches)
+        {
+            matches[j] = matches[j - 1];
+        }
+    }
+    if (j < maxMatches)
+    {
+        matches[j] = match;
+    }
+    return 1;
+}
+
+int printFuzzyMatches(AddressBook* book, const char* query, int maxShown)
+{
+    FuzzyMatch matches[10];
+    int found = fuzzySearchContacts(book, query, matches, maxShown < 10 ? maxShown : 10);
+    Contact* c = NULL;
+
+    if (found == 0)
+    {
+        printf("No contacts close to '%s'.\n", query);
+        return 0;
+    }
+    for (int i = 0; i < found && i < maxShown && i < 10; i++)
+    {
+        c = book->contacts[matches[i].position];
+        printf("Index %d: %s %s (distance %d)\n", matches[i].position, c->firstName, c->familyName, matches[i].distance);
+    }
+    return found;
+}
+
+bool fuzzySearchInteractive(AddressBook* book)
+{
+    char query[100] = {"\0"};
+
+    printf("Enter a name, or first and family name: ");
+    if (scanf(" %99[^\n]", query) != 1)
+    {
+        return false;
+    }
+    return printFuzzyMatches(book, query, 10) > 0;
+}
+
+void freeContactColumns(ContactColumns* columns)
+{
+    free(columns->phones);
+    free(columns->ages);
+    free(columns->firstNames);
+    free(columns->familyNames);
+    columns->phones = NULL;
+    columns->ages = NULL;
+    columns->firstNames = NULL;
+    columns->familyNames = NULL;
+    columns->count = 0;
+}
+
+bool ensureContactColumns(AddressBook* book)
+{
+    ContactColumns* columns = &book->columns;
+    int rows = 0;
+    Contact* c = NULL;
+
+    settleRemovals(book);
+    if (columns->phones != NULL && columns->builtVersion == book->version)
+    {
+        return true;
+    }
+    freeContactColumns(columns);
+    rows = (book->count + 63) / 64 * 64;
+    columns->phones = (int64_t*)allocateZeroed(rows + 64, sizeof(int64_t));
+    columns->ages = (uint8_t*)allocateZeroed(rows + 64, sizeof(uint8_t));
+    columns->firstNames = (const char**)allocate((book->count + 1) * sizeof(const char*));
+    columns->familyNames = (const char**)allocate((book->count + 1) * sizeof(const char*));
+    if (columns->phones == NULL || columns->ages == NULL || columns->firstNames == NULL || columns->familyNames == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in ensureContactColumns");
+        freeContactColumns(columns);
+        return false;
+    }
+    for (int i = 0; i < book->count; i++)
+    {
+        c = book->contacts[i];
+        columns->phones[i] = c->phonNum;
+        columns->ages[i] = (uint8_t)c->age;
+        columns->firstNames[i] = c->firstName;
+        columns->familyNames[i] = c->familyName;
+    }
+    columns->count = book->count;
+    columns->builtVersion = book->version;
+    return true;
+}
+
+/*
+The kernels clear the bits of rows outside a range and leave the rest alone, so
+filters compose by running one kernel after another over the same selection. A value
+is in [low, low + span] when value - low, wrapped to unsigned, is at most span.
+*/
+void selectAgeRangeScalar(const uint8_t* ages, int numWords, uint8_t low, uint8_t span, uint64_t* selection)
+{
+    uint64_t bits = 0;
+
+    for (int w = 0; w < numWords; w++)
+    {
+        bits = 0;
+        for (int j = 0; j < 64; j++)
+        {
+            bits |= (uint64_t)((uint8_t)(ages[w * 64 + j] - low) <= span) << j;
+        }
+        selection[w] &= bits;
+    }
+}
+
+void selectPhoneRangeScalar(const int64_t* phones, int numWords, int64_t low, uint64_t span, uint64_t* selection)
+{
+    uint64_t bits = 0;
+
+    for (int w = 0; w < numWords; w++)
+    {
+        bits = 0;
+        for (int j = 0; j < 64; j++)
+        {
+            bits |= (uint64_t)((uint64_t)(phones[w * 64 + j] - low) <= span) << j;
+        }
+        selection[w] &= bits;
+    }
+}
+
+#ifdef X86_FILTER_KERNELS
+/*
+16 ages per compare. SSE2 has no unsigned byte compare, but x <= span exactly when
+min(x, span) == x.
+*/
+void selectAgeRangeSse2(const uint8_t* ages, int numWords, uint8_t low, uint8_t span, uint64_t* selection)
+{
+    __m128i lowVector = _mm_set1_epi8((char)low);
+    __m128i spanVector = _mm_set1_epi8((char)span);
+    __m128i shifted;
+    uint64_t bits = 0;
+
+    for (int w = 0; w < numWords; w++)
+    {
+        bits = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            shifted = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(ages + w * 64 + k * 16)), lowVector);
+            bits |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(shifted, spanVector), shifted)) << (k * 16);
+        }
+        selection[w] &= bits;
+    }
+}
+
+__attribute__((target("avx2")))
+void selectAgeRangeAvx2(const uint8_t* ages, int numWords, uint8_t low, uint8_t span, uint64_t* selection)
+{
+    __m256i lowVector = _mm256_set1_epi8((char)low);
+    __m256i spanVector = _mm256_set1_epi8((char)span);
+    __m256i first;
+    __m256i second;
+    uint64_t bits = 0;
+
+    for (int w = 0; w < numWords; w++)
+    {
+        first = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i*)(ages + w * 64)), lowVector);
+        second = _mm256_sub_epi8(_mm256_loadu_si256((const __m256i*)(ages + w * 64 + 32)), lowVector);
+        bits = (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(first, spanVector), first));
+        bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(second, spanVector), second)) << 32;
+        selection[w] &= bits;
+    }
+}
+
+/*
+4 phones per compare. AVX2 only has a signed 64-bit compare, so both sides of the
+unsigned test get their sign bit flipped first.
+*/
+__attribute__((target("avx2")))
+void selectPhoneRangeAvx2(const int64_t* phones, int numWords, int64_t low, uint64_t span, uint64_t* selection)
+{
+    __m256i lowVector = _mm256_set1_epi64x(low);
+    __m256i signBit = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+    __m256i spanVector = _mm256_xor_si256(_mm256_set1_epi64x((long long)span), signBit);
+    __m256i shifted;
+    uint64_t outside = 0;
+
+    for (int w = 0; w < numWords; w++)
+    {
+        outside = 0;
+        for (int k = 0; k < 16; k++)
+        {
+            shifted = _mm256_sub_epi64(_mm256_loadu_si256((const __m256i*)(phones + w * 64 + k * 4)), lowVector);
+            shifted = _mm256_xor_si256(shifted, signBit);
+            outside |= (uint64_t)(uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(shifted, spanVector))) << (k * 4);
+        }
+        selection[w] &= ~outside;
+    }
+}
+#endif
+
+void selectAgeRange(ContactColumns* columns, int minAge, int maxAge, uint64_t* selection)
+{
+    int numWords = (columns->count + 63) / 64;
+    uint8_t low = 0;
+    uint8_t span = 0;
+
+    minAge = minAge < 0 ? 0 : minAge;
+    maxAge = maxAge > 255 ? 255 : maxAge;
+    if (minAge > maxAge)
+    {
+        memset(selection, 0, numWords * sizeof(uint64_t));
+        return;
+    }
+    low = (uint8_t)minAge;
+    span = (uint8_t)(maxAge - minAge);
+#ifdef X86_FILTER_KERNELS
+    if (__builtin_cpu_supports("avx2"))
+    {
+        selectAgeRangeAvx2(columns->ages, numWords, low, span, selection);
+    }
+    else
+    {
+        selectAgeRangeSse2(columns->ages, numWords, low, span, selection);
+    }
+#else
+    selectAgeRangeScalar(columns->ages, numWords, low, span, selection);
+#endif
+}
+
+void selectPhoneRange(ContactColumns* columns, long long minPhone, long long maxPhone, uint64_t* selection)
+{
+    int numWords = (columns->count + 63) / 64;
+    uint64_t span = 0;
+
+    if (minPhone > maxPhone)
+    {
+        memset(selection, 0, numWords * sizeof(uint64_t));
+        return;
+    }
+    span = (uint64_t)maxPhone - (uint64_t)minPhone;
+#ifdef X86_FILTER_KERNELS
+    if (__builtin_cpu_supports("avx2"))
+    {
+        selectPhoneRangeAvx2(columns->phones, numWords, minPhone, span, selection);
+        return;
+    }
+#endif
+    selectPhoneRangeScalar(columns->phones, numWords, minPhone, span, selection);
+}
+
+/*
+Phone numbers are 10 digits without a leading zero, so the numbers starting with a
+d digit prefix p are p * 10^(10 - d) up to (p + 1) * 10^(10 - d) - 1.
+*/
+bool phonePrefixRange(const char* prefix, long long* minPhone, long long* maxPhone)
+{
+    size_t length = strlen(prefix);
+    long long scale = 1;
+
+    if (length == 0 || length > 10 || prefix[0] == '0')
+    {
+        fprintf(stderr, "Error: Invalid phone prefix.\n");
+        return false;
+    }
+    *minPhone = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (prefix[i] < '0' || prefix[i] > '9')
+        {
+            fprintf(stderr, "Error: Invalid phone prefix.\n");
+            return false;
+        }
+        *minPhone = *minPhone * 10 + (prefix[i] - '0');
+    }
+    for (size_t i = length; i < 10; i++)
+    {
+        scale *= 10;
+    }
+    *minPhone *= scale;
+    *maxPhone = *minPhone + scale - 1;
+    return true;
+}
+
+/*
+Runs the filter over the columns into a selection bitmap, bit i of word i / 64 set
+for every matching contacts[i]. The caller frees *selection. Returns the number of
+matches, -1 on allocation failure.
+*/
+int filterContacts(AddressBook* book, const ContactFilter* filter, uint64_t** selection)
+{
+    int numWords = 0;
+    int found = 0;
+
+    *selection = NULL;
+    if (!ensureContactColumns(book))
+    {
+        return -1;
+    }
+    numWords = (book->count + 63) / 64;
+    *selection = (uint64_t*)allocate((numWords + 1) * sizeof(uint64_t));
+    if (*selection == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in filterContacts");
+        return -1;
+    }
+    memset(*selection, 0xff, numWords * sizeof(uint64_t));
+    if (book->count % 64 != 0)
+    {
+        /*the padding rows never match*/
+        (*selection)[numWords - 1] = ~0ULL >> (64 - book->count % 64);
+    }
+
+    if (filter->minAge > 0 || filter->maxAge < 255)
+    {
+        selectAgeRange(&book->columns, filter->minAge, filter->maxAge, *selection);
+    }
+    if (filter->minPhone > LLONG_MIN || filter->maxPhone < LLONG_MAX)
+    {
+        selectPhoneRange(&book->columns, filter->minPhone, filter->maxPhone, *selection);
+    }
+    for (int w = 0; w < numWords; w++)
+    {
+        found += __builtin_popcountll((*selection)[w]);
+    }
+    return found;
+}
+
+/*
+Lists the positions of the set bits of a selection in increasing order.
+*/
+int selectionToIndexes(const uint64_t* selection, int count, int indexes[], int maxIndexes)
+{
+    int numWords = (count + 63) / 64;
+    int found = 0;
+    uint64_t bits = 0;
+
+    for (int w = 0; w < numWords && found < maxIndexes; w++)
+    {
+        for (bits = selection[w]; bits != 0 && found < maxIndexes; bits &= bits - 1)
+        {
+            indexes[found++] = w * 64 + __builtin_ctzll(bits);
+        }
+    }
+    return found;
+}
+
+int printFilterMatches(AddressBook* book, const ContactFilter* filter)
+{
+    const int MAX_SHOWN = 20;
+    int indexes[20];
+    uint64_t* selection = NULL;
+    int found = filterContacts(book, filter, &selection);
+    int shown = 0;
+    Contact* c = NULL;
+
+    if (found <= 0)
+    {
+        free(selection);
+        if (found == 0)
+        {
+            printf("No contacts match the filter.\n");
+        }
+        return found;
+    }
+    shown = selectionToIndexes(selection, book->count, indexes, MAX_SHOWN);
+    for (int i = 0; i < shown; i++)
+    {
+        c = book->contacts[indexes[i]];
+        printf("Index %d: %s %s, %lld, age %d\n", indexes[i], c->firstName, c->familyName, c->phonNum, c->age);
+    }
+    if (found > shown)
+    {
+        printf("... and %d more\n", found - shown);
+    }
+    free(selection);
+    return found;
+}
+
+bool filterContactsInteractive(AddressBook* book)
+{
+    ContactFilter filter = {0, 255, LLONG_MIN, LLONG_MAX};
+    char prefix[16] = {"\0"};
+
+    printf("Youngest age to include: ");
+    if (scanf("%d", &filter.minAge) != 1)
+    {
+        return false;
+    }
+    printf("Oldest age to include: ");
+    if (scanf("%d", &filter.maxAge) != 1)
+    {
+        return false;
+    }
+    printf("Phone number prefix (- for any): ");
+    if (scanf("%15s", prefix) != 1)
+    {
+        return false;
+    }
+    if (strcmp(prefix, "-") != 0 && !phonePrefixRange(prefix, &filter.minPhone, &filter.maxPhone))
+    {
+        return false;
+    }
+    return printFilterMatches(book, &filter) > 0;
+}
+
+/*
+One pass over the age column into four histograms, so runs of equal ages do not
+serialize on the same counter, then min, max, mean and median of the known ages
+come from the merged histogram.
+*/
+void summarizeAges(const ContactColumns* columns, AgeSummary* summary)
+{
+    int partial[4][256];
+    int i = 0;
+    int known = 0;
+    int seen = 0;
+    int lowRank = 0;
+    int highRank = 0;
+    int low = -1;
+    int high = -1;
+    unsigned long long total = 0;
+
+    memset(partial, 0, sizeof(partial));
+    memset(summary, 0, sizeof(AgeSummary));
+    for (; i + 4 <= columns->count; i += 4)
+    {
+        partial[0][columns->ages[i]]++;
+        partial[1][columns->ages[i + 1]]++;
+        partial[2][columns->ages[i + 2]]++;
+        partial[3][columns->ages[i + 3]]++;
+    }
+    for (; i < columns->count; i++)
+    {
+        partial[0][columns->ages[i]]++;
+    }
+
+    summary->count = columns->count;
+    summary->unknown = partial[0][0] + partial[1][0] + partial[2][0] + partial[3][0];
+    known = columns->count - summary->unknown;
+    if (known == 0)
+    {
+        return;
+    }
+    lowRank = (known - 1) / 2;
+    highRank = known / 2;
+    summary->minAge = -1;
+    for (int age = 1; age < 256; age++)
+    {
+        summary->histogram[age] = partial[0][age] + partial[1][age] + partial[2][age] + partial[3][age];
+        if (summary->histogram[age] == 0)
+        {
+            continue;
+        }
+        if (summary->minAge < 0)
+        {
+            summary->minAge = age;
+        }
+        summary->maxAge = age;
+        total += (unsigned long long)age * summary->histogram[age];
+        seen += summary->histogram[age];
+        if (low < 0 && seen > lowRank)
+        {
+            low = age;
+        }
+        if (high < 0 && seen > highRank)
+        {
+            high = age;
+        }
+    }
+    summary->mean = (double)total / known;
+    summary->median = (low + high) / 2.0;
+}
+
+/*
+Area codes are the first three digits of a 10 digit phone number, so they index a
+flat table directly and no hashing is needed. Numbers outside 10 digits count under
+code -1. Returns the number of groups, -1 on allocation failure.
+*/
+int countAreaCodes(const ContactColumns* columns, GroupCount** groups)
+{
+    const int NUM_CODES = 1000;
+    int counts[1001];
+    int numGroups = 0;
+    uint64_t phone = 0;
+
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < columns->count; i++)
+    {
+        phone = (uint64_t)columns->phones[i];
+        counts[phone >= 1000000000ULL && phone < 10000000000ULL ? phone / 10000000 : NUM_CODES]++;
+    }
+    *groups = (GroupCount*)allocate((NUM_CODES + 1) * sizeof(GroupCount));
+    if (*groups == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in countAreaCodes");
+        return -1;
+    }
+    for (int code = 0; code <= NUM_CODES; code++)
+    {
+        if (counts[code] > 0)
+        {
+            (*groups)[numGroups].name = NULL;
+            (*groups)[numGroups].code = code < NUM_CODES ? code : -1;
+            (*groups)[numGroups].count = counts[code];
+            numGroups++;
+        }
+    }
+    return numGroups;
+}
+
+#define FAMILY_LOOKAHEAD 8
+
+/*
+Doubles the slot table of countFamilyNames.
+*/
+bool growFamilyTable(FamilySlot** slots, size_t* capacity)
+{
+    size_t mask = *capacity * 2 - 1;
+    size_t slot = 0;
+    FamilySlot* grown = (FamilySlot*)allocate(*capacity * 2 * sizeof(FamilySlot));
+
+    if (grown == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in growFamilyTable");
+        return false;
+    }
+    memset(grown, -1, *capacity * 2 * sizeof(FamilySlot));
+    for (size_t old = 0; old < *capacity; old++)
+    {
+        if ((*slots)[old].group < 0)
+        {
+            continue;
+        }
+        for (slot = (*slots)[old].hash & mask; grown[slot].group >= 0; slot = (slot + 1) & mask)
+        {
+        }
+        grown[slot] = (*slots)[old];
+    }
+    free(*slots);
+    *slots = grown;
+    *capacity *= 2;
+    return true;
+}
+
+/*
+Hash aggregation of the family name column. Groups are appended to a dense array,
+an open addressing table of slots finds them again and doubles when half full, so
+it is sized by the distinct names rather than the contacts. Names are hashed
+FAMILY_LOOKAHEAD contacts ahead of their probe and their slot prefetched, which
+overlaps the cache misses of the table. Returns the number of groups, -1 on
+allocation failure.
+*/
+int countFamilyNames(const ContactColumns* columns, GroupCount** groups)
+{
+    size_t capacity = 1024;
+    size_t slot = 0;
+    FamilySlot* slots = (FamilySlot*)allocate(capacity * sizeof(FamilySlot));
+    unsigned int ahead[2 * FAMILY_LOOKAHEAD];
+    unsigned int hash = 0;
+    int numGroups = 0;
+    int groupCapacity = 1024;
+    const char* name = NULL;
+    GroupCount* grown = NULL;
+
+    *groups = (GroupCount*)allocate(groupCapacity * sizeof(GroupCount));
+    if (*groups == NULL || slots == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in countFamilyNames");
+        numGroups = -1;
+    }
+    else
+    {
+        memset(slots, -1, capacity * sizeof(FamilySlot));
+    }
+
+    for (int i = 0; numGroups >= 0 && i < columns->count + FAMILY_LOOKAHEAD; i++)
+    {
+        if (i < columns->count)
+        {
+            hash = 2166136261u;
+            for (const char* p = columns->familyNames[i]; *p != '\0'; p++)
+            {
+                hash = (hash ^ (unsigned char)*p) * 16777619u;
+            }
+            ahead[i % (2 * FAMILY_LOOKAHEAD)] = hash;
+            __builtin_prefetch(&slots[hash & (capacity - 1)]);
+        }
+        if (i < FAMILY_LOOKAHEAD)
+        {
+            continue;
+        }
+
+        hash = ahead[(i - FAMILY_LOOKAHEAD) % (2 * FAMILY_LOOKAHEAD)];
+        name = columns->familyNames[i - FAMILY_LOOKAHEAD];
+        for (slot = hash & (capacity - 1); slots[slot].group >= 0; slot = (slot + 1) & (capacity - 1))
+        {
+            if (slots[slot].hash == hash && strcmp((*groups)[slots[slot].group].name, name) == 0)
+            {
+                break;
+            }
+        }
+        if (slots[slot].group >= 0)
+        {
+            (*groups)[slots[slot].group].count++;
+            continue;
+        }
+
+        if (numGroups == groupCapacity)
+        {
+            grown = (GroupCount*)realloc(*groups, groupCapacity * 2 * sizeof(GroupCount));
+            if (grown == NULL)
+            {
+                fprintf(stderr, "Error: Memory allocation failed in countFamilyNames");
+                numGroups = -1;
+                break;
+            }
+            *groups = grown;
+            groupCapacity *= 2;
+        }
+        (*groups)[numGroups].name = name;
+        (*groups)[numGroups].code = 0;
+        (*groups)[numGroups].count = 1;
+        slots[slot].hash = hash;
+        slots[slot].group = numGroups++;
+        if ((size_t)numGroups * 2 > capacity && !growFamilyTable(&slots, &capacity))
+        {
+            numGroups = -1;
+        }
+    }
+
+    if (numGroups < 0)
     {
-        fprintf(stderr, "Error: File to load not found");
-        return NULL;
+        free(*groups);
+        *groups = NULL;
     }
+    free(slots);
+    return numGroups;
+}
+
+/*
+Largest groups first, ties in code then name order.
+*/
+int compareGroupCounts(const void* a, const void* b)
+{
+    const GroupCount* left = (const GroupCount*)a;
+    const GroupCount* right = (const GroupCount*)b;
 
-    fgets(getBuffer, sizeof(getBuffer), inputStream);
-    if (sscanf(getBuffer, "%d", &numContacts) != 1)
+    if (left->count != right->count)
     {
-        fprintf(stderr, "Error: failed to get number of contacts in file");
-        fclose(inputStream);
+        return left->count < right->count ? 1 : -1;
+    }
+    if (left->code != right->code)
+    {
+        return left->code < right->code ? -1 : 1;
+    }
+    if (left->name == NULL || right->name == NULL)
+    {
+        return 0;
+    }
+    return strcmp(left->name, right->name);
+}
+
+bool printAggregates(AddressBook* book, bool byFamily)
+{
+    const int MAX_SHOWN = 20;
+    AgeSummary summary;
+    GroupCount* groups = NULL;
+    int numGroups = 0;
+    int shown = 0;
+    int inDecade = 0;
+
+    if (!ensureContactColumns(book))
+    {
+        return false;
+    }
+    summarizeAges(&book->columns, &summary);
+    printf("Contacts: %d\n", summary.count);
+    if (summary.count == 0)
+    {
+        return true;
+    }
+    if (summary.unknown > 0)
+    {
+        printf("Unknown age: %d\n", summary.unknown);
+    }
+    if (summary.unknown < summary.count)
+    {
+        printf("Age min: %d, max: %d, mean: %.2f, median: %.1f\n", summary.minAge, summary.maxAge, summary.mean, summary.median);
+        printf("Ages:\n");
+        for (int decade = summary.minAge / 10 * 10; decade <= summary.maxAge; decade += 10)
+        {
+            inDecade = 0;
+            for (int age = decade; age < decade + 10 && age < 256; age++)
+            {
+                inDecade += summary.histogram[age];
+            }
+            printf("  %3d-%-3d %d\n", decade, decade + 9, inDecade);
+        }
+    }
+
+    numGroups = byFamily ? countFamilyNames(&book->columns, &groups) : countAreaCodes(&book->columns, &groups);
+    if (numGroups < 0)
+    {
+        return false;
+    }
+    qsort(groups, numGroups, sizeof(GroupCount), compareGroupCounts);
+    shown = numGroups < MAX_SHOWN ? numGroups : MAX_SHOWN;
+    printf("%s (%d):\n", byFamily ? "Family names" : "Area codes", numGroups);
+    for (int i = 0; i < shown; i++)
+    {
+        if (byFamily)
+        {
+            printf("  %s %d\n", groups[i].name, groups[i].count);
+        }
+        else if (groups[i].code < 0)
+        {
+            printf("  other %d\n", groups[i].count);
+        }
+        else
+        {
+            printf("  %03d %d\n", groups[i].code, groups[i].count);
+        }
+    }
+    if (numGroups > shown)
+    {
+        printf("... and %d more\n", numGroups - shown);
+    }
+    free(groups);
+    return true;
+}
+
+bool printAggregatesInteractive(AddressBook* book)
+{
+    char groupBy[16] = {"\0"};
+
+    printf("Group contacts by (area/family): ");
+    if (scanf("%15s", groupBy) != 1)
+    {
+        return false;
+    }
+    if (strcmp(groupBy, "area") != 0 && strcmp(groupBy, "family") != 0)
+    {
+        fprintf(stderr, "Error: Unknown grouping.\n");
+        return false;
+    }
+    return printAggregates(book, strcmp(groupBy, "family") == 0);
+}
+
+/*
+Builds a heap owned contact from text fields the way readNewContact does, storing 0
+for a phone number or age that does not validate.
+*/
+Contact* newContactFromFields(const char* firstName, const char* familyName, const char* address, const char* phone, const char* age)
+{
+    Contact* newContact = (Contact*)allocate(sizeof(Contact));
+    char buffer[100] = {"\0"};
+    size_t used = 0;
+
+    if (newContact == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for Contact in newContactFromFields");
         return NULL;
     }
+    newContact->flags = OWNS_CONTACT;
+    newContact->firstName = ownContactString(newContact, &used, OWNS_FIRST_NAME, firstName);
+    newContact->familyName = ownContactString(newContact, &used, OWNS_FAMILY_NAME, familyName);
+    newContact->address = ownContactString(newContact, &used, OWNS_ADDRESS, address);
+    if (newContact->firstName == NULL || newContact->familyName == NULL || newContact->address == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed for Contact in newContactFromFields");
+        freeContact(newContact);
+        return NULL;
+    }
+
+    snprintf(buffer, sizeof(buffer), "%s", phone);
+    newContact->phonNum = validPhoneNumber(buffer) ? atoll(buffer) : 0;
+    if (newContact->phonNum == 0)
+    {
+        fprintf(stderr, "Error: Could not read a valid phone number\n");
+    }
+    snprintf(buffer, sizeof(buffer), "%s", age);
+    newContact->age = validAge(buffer) ? atoi(buffer) : 0;
+    if (newContact->age == 0)
+    {
+        fprintf(stderr, "Error: Could not read a valid age\n");
+    }
+    return newContact;
+}
+
+/*
+Splits a command line in place into words. Double quotes group words containing
+spaces; a # outside quotes starts a comment. Returns the number of words.
+*/
+int splitCommand(char* line, char* words[], int maxWords)
+{
+    int count = 0;
+    char* read = line;
+    char* write = NULL;
+
+    while (count < maxWords)
+    {
+        while (isspace((unsigned char)*read))
+        {
+            read++;
+        }
+        if (*read == '\0' || *read == '#')
+        {
+            break;
+        }
+        words[count++] = write = read;
+        while (*read != '\0' && !isspace((unsigned char)*read))
+        {
+            if (*read == '"')
+            {
+                read++;
+                while (*read != '\0' && *read != '"')
+                {
+                    *write++ = *read++;
+                }
+                if (*read == '"')
+                {
+                    read++;
+                }
+            }
+            else
+            {
+                *write++ = *read++;
+            }
+        }
+        if (*read != '\0')
+        {
+            read++;
+        }
+        *write = '\0';
+    }
+    return count;
+}
+
+/*
+Looks a word up in a NULL terminated table, returning its 1-based position or 0.
+The tables below are laid out to match the EditOption, SortKey and SortOrder values.
+*/
+int lookupWord(const char* word, const char* const table[])
+{
+    for (int i = 0; table[i] != NULL; i++)
+    {
+        if (strcmp(word, table[i]) == 0)
+        {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+/*
+Runs one batch command. Returns false when the command is unknown or fails.
+*/
+bool runBatchCommand(AddressBook* book, char* line)
+{
+    static const char* const EDIT_FIELDS[] = {"first", "family", "address", "phone", "age", NULL};
+    static const char* const SORT_KEYS[] = {"name", "age", "phone", "address", NULL};
+    static const char* const SORT_ORDERS[] = {"asc", "desc", NULL};
+    const int MAX_WORDS = MAX_MERGE_FILES + 4;
+    char* words[MAX_MERGE_FILES + 4];
+    int numWords = splitCommand(line, words, MAX_WORDS);
+    char* command = words[0];
+    int index = 0;
+    int field = 0;
+    int key = 0;
+    int order = SORT_ASCENDING;
+    char value[100] = {"\0"};
+
+    if (numWords == 0)
+    {
+        return true;
+    }
+
+    if (numWords == 2 && strcmp(command, "load") == 0)
+    {
+        return loadContactsFromFile(book, words[1]);
+    }
+    if (numWords == 2 && strcmp(command, "load-mapped") == 0)
+    {
+        return loadContactsMapped(book, words[1]);
+    }
+    if (numWords == 2 && strcmp(command, "load-lazy") == 0)
+    {
+        return loadContactsLazy(book, words[1]);
+    }
+    if (numWords == 2 && strcmp(command, "load-snapshot") == 0)
+    {
+        return loadSnapshot(book, words[1]);
+    }
+    if (numWords == 2 && strcmp(command, "append") == 0)
+    {
+        return appendContactsFromFile(book, words[1]);
+    }
+    if (numWords == 2 && strcmp(command, "merge") == 0)
+    {
+        return mergeContactsFromFile(book, words[1]);
+    }
+    if (numWords >= 2 && strcmp(command, "merge-files") == 0)
+    {
+        if (numWords == MAX_WORDS)
+        {
+            fprintf(stderr, "Error: at most %d files can be merged at once\n", MAX_MERGE_FILES);
+            return false;
+        }
+        if (strcmp(words[1], "-o") != 0)
+        {
+            return mergeContactFiles(book, words + 1, numWords - 1);
+        }
+        if (numWords < 4)
+        {
+            fprintf(stderr, "Error: usage: merge-files [-o OUTPUT] FILE...\n");
+            return false;
+        }
+        return mergeContactFilesTo(words[2], words + 3, numWords - 3);
+    }
+    if (numWords == 2 && strcmp(command, "save") == 0)
+    {
+        return saveContactsToFile(book, words[1]);
+    }
+    if (numWords == 2 && strcmp(command, "save-snapshot") == 0)
+    {
+        return saveSnapshot(book, words[1]);
+    }
+    if (numWords == 2 && strcmp(command, "print") == 0)
+    {
+        printContactsToFile(book, words[1]);
+        return true;
+    }
+    if (numWords == 1 && strcmp(command, "list") == 0)
+    {
+        listContacts(book);
+        return true;
+    }
+    if (numWords >= 3 && strcmp(command, "page") == 0)
+    {
+        /*page OFFSET SIZE [by KEY [asc|desc]] [where PREFIX]*/
+        const char* filter = "";
+        for (int w = 3; w < numWords; w++)
+        {
+            if (strcmp(words[w], "by") == 0 && w + 1 < numWords && (key = lookupWord(words[w + 1], SORT_KEYS)) != 0)
+            {
+                w += 1;
+                if (w + 1 < numWords && lookupWord(words[w + 1], SORT_ORDERS) != 0)
+                {
+                    order = lookupWord(words[++w], SORT_ORDERS);
+                }
+            }
+            else if (strcmp(words[w], "where") == 0 && w + 1 < numWords)
+            {
+                filter = words[++w];
+            }
+            else
+            {
+                fprintf(stderr, "Error: usage: page OFFSET SIZE [by KEY [asc|desc]] [where PREFIX]\n");
+                return false;
+            }
+        }
+        return listContactsPage(book, atoi(words[1]), atoi(words[2]), filter, key, order);
+    }
+    if (numWords == 6 && (strcmp(command, "insert") == 0 || strcmp(command, "add") == 0))
+    {
+        Contact* newContact = newContactFromFields(words[1], words[2], words[3], words[4], words[5]);
+        if (newContact == NULL)
+        {
+            return false;
+        }
+        if (!(command[0] == 'i' ? insertContactAlphabetical(book, newContact) : appendContact(book, newContact)))
+        {
+            freeContact(newContact);
+            return false;
+        }
+        return true;
+    }
+    if (numWords == 2 && strcmp(command, "remove") == 0)
+    {
+        index = atoi(words[1]);
+        if (!(0 <= index && index < liveContacts(book)))
+        {
+            fprintf(stderr, "Error: Index out of range in remove\n");
+            return false;
+        }
+        removeContactAt(book, contactSlot(book, index));
+        report("Contact removed successfully.\n");
+        return true;
+    }
+    if (numWords == 3 && strcmp(command, "remove-name") == 0)
+    {
+        return removeContactNamed(book, words[1], words[2]);
+    }
+    if (numWords >= 3 && strcmp(command, "remove-where") == 0)
+    {
+        /*remove-where age MIN [MAX] | phone NUMBER | name FIRST FAMILY [FIRST FAMILY ...]*/
+        ContactFilter filter = {0, 255, LLONG_MIN, LLONG_MAX};
+        if (strcmp(words[1], "name") == 0 && numWords % 2 == 0)
+        {
+            char* firstNames[MAX_MERGE_FILES / 2 + 2];
+            char* familyNames[MAX_MERGE_FILES / 2 + 2];
+            for (int w = 2; w < numWords; w += 2)
+            {
+                firstNames[w / 2 - 1] = words[w];
+                familyNames[w / 2 - 1] = words[w + 1];
+            }
+            return removeContactsNamed(book, firstNames, familyNames, (numWords - 2) / 2) >= 0;
+        }
+        if (strcmp(words[1], "age") == 0 && (numWords == 3 || numWords == 4))
+        {
+            filter.minAge = atoi(words[2]);
+            filter.maxAge = atoi(words[numWords - 1]);
+            return removeContactsMatching(book, &filter) >= 0;
+        }
+        if (strcmp(words[1], "phone") == 0 && numWords == 3)
+        {
+            filter.minPhone = atoll(words[2]);
+            filter.maxPhone = filter.minPhone;
+            return removeContactsMatching(book, &filter) >= 0;
+        }
+        fprintf(stderr, "Error: usage: remove-where age MIN [MAX] | phone NUMBER | name FIRST FAMILY [FIRST FAMILY ...]\n");
+        return false;
+    }
+    if (numWords == 4 && strcmp(command, "edit") == 0)
+    {
+        index = atoi(words[1]);
+        field = lookupWord(words[2], EDIT_FIELDS);
+        snprintf(value, sizeof(value), "%s", words[3]);
+        if (!(0 <= index && index < liveContacts(book)) || field == 0
+            || (field == EDIT_PHN && !validPhoneNumber(value)) || (field == EDIT_AGE && !validAge(value)))
+        {
+            fprintf(stderr, "Error: Invalid edit\n");
+            return false;
+        }
+        return applyContactEdit(book, contactSlot(book, index), field, value);
+    }
+    if ((numWords == 2 || numWords == 3) && strcmp(command, "sort") == 0)
+    {
+        key = lookupWord(words[1], SORT_KEYS);
+        order = numWords == 3 ? lookupWord(words[2], SORT_ORDERS) : SORT_ASCENDING;
+        if (key == 0 || order == 0)
+        {
+            fprintf(stderr, "Error: usage: sort name|age|phone|address [asc|desc]\n");
+            return false;
+        }
+        return sortContacts(book, key, order);
+    }
+    if (numWords == 2 && strcmp(command, "open-journal") == 0)
+    {
+        return openJournaledBook(book, words[1]);
+    }
+    if (numWords == 1 && strcmp(command, "compact") == 0)
+    {
+        return compactJournal(book);
+    }
+    if (numWords == 2 && strcmp(command, "find-phone") == 0)
+    {
+        return printContactsWithPhone(book, atoll(words[1]));
+    }
+    if (numWords == 2 && strcmp(command, "remove-phone") == 0)
+    {
+        return removeContactByPhone(book, atoll(words[1]));
+    }
+    if (numWords == 4 && strcmp(command, "edit-phone") == 0)
+    {
+        index = findUniqueContactByPhone(book, atoll(words[1]));
+        if (index < 0)
+        {
+            return false;
+        }
+        field = lookupWord(words[2], EDIT_FIELDS);
+        snprintf(value, sizeof(value), "%s", words[3]);
+        if (field == 0 || (field == EDIT_PHN && !validPhoneNumber(value)) || (field == EDIT_AGE && !validAge(value)))
+        {
+            fprintf(stderr, "Error: Invalid edit\n");
+            return false;
+        }
+        return applyContactEdit(book, index, field, value);
+    }
+    if ((numWords == 1 || numWords == 2) && strcmp(command, "search") == 0)
+    {
+        printPrefixMatches(book, numWords == 2 ? words[1] : "");
+        return true;
+    }
+    if ((numWords == 1 || numWords == 3) && strcmp(command, "aggregate") == 0)
+    {
+        /*aggregate [by area|family]*/
+        if (numWords == 3 && (strcmp(words[1], "by") != 0 || (strcmp(words[2], "area") != 0 && strcmp(words[2], "family") != 0)))
+        {
+            fprintf(stderr, "Error: usage: aggregate [by area|family]\n");
+            return false;
+        }
+        return printAggregates(book, numWords == 3 && strcmp(words[2], "family") == 0);
+    }
+    if (numWords >= 3 && strcmp(command, "filter") == 0)
+    {
+        /*filter [age MIN MAX] [phone PREFIX], in any order*/
+        ContactFilter filter = {0, 255, LLONG_MIN, LLONG_MAX};
+        for (int w = 1; w < numWords; w++)
+        {
+            if (strcmp(words[w], "age") == 0 && w + 2 < numWords)
+            {
+                filter.minAge = atoi(words[w + 1]);
+                filter.maxAge = atoi(words[w + 2]);
+                w += 2;
+            }
+            else if (strcmp(words[w], "phone") == 0 && w + 1 < numWords)
+            {
+                if (!phonePrefixRange(words[++w], &filter.minPhone, &filter.maxPhone))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                fprintf(stderr, "Error: usage: filter [age MIN MAX] [phone PREFIX]\n");
+                return false;
+            }
+        }
+        return printFilterMatches(book, &filter) >= 0;
+    }
+    if (numWords == 2 && strcmp(command, "fuzzy") == 0)
+    {
+        printFuzzyMatches(book, words[1], 10);
+        return true;
+    }
+    if (numWords == 2 && strcmp(command, "threads") == 0)
+    {
+        return setLoadThreads(words[1]);
+    }
+    if (numWords == 2 && strcmp(command, "tombstones") == 0)
+    {
+        return setDeferRemovals(words[1]);
+    }
+    if (numWords == 1 && strcmp(command, "stats") == 0)
+    {
+        printStatistics(stdout);
+        return true;
+    }
+    if (numWords == 2 && strcmp(command, "stats") == 0 && strcmp(words[1], "reset") == 0)
+    {
+        resetStatistics();
+        return true;
+    }
+    if ((numWords == 3 || numWords == 4) && strcmp(command, "generate") == 0)
+    {
+        return generateContactsFile(words[2], atoi(words[1]), numWords == 4 ? strtoull(words[3], NULL, 10) : 1);
+    }
+    if ((numWords == 2 || numWords == 3) && strcmp(command, "benchmark") == 0)
+    {
+        if (numWords == 3 && strcmp(words[2], "json") != 0 && strcmp(words[2], "csv") != 0)
+        {
+            fprintf(stderr, "Error: usage: benchmark COUNT [csv|json]\n");
+            return false;
+        }
+        return runBenchmark(atoi(words[1]), numWords == 3 && strcmp(words[2], "json") == 0);
+    }
+
+    fprintf(stderr, "Error: unknown command or wrong number of arguments: %s\n", command);
+    return false;
+}
+
+/*
+Runs a script of batch commands, one per line. A line that does not fit in line is
+skipped and counted as failed. Returns the number of failed commands.
+*/
+int runBatchScript(AddressBook* book, FILE* script, const char* scriptName)
+{
+    char line[1024] = {"\0"};
+    int lineNumber = 0;
+    int failures = 0;
+    int next = 0;
+    bool tooLong = false;
 
-    for (int i = 0; i < numContacts; i++)
+    while (fgets(line, sizeof(line), script) != NULL)
     {
-        newContact = (Contact*)malloc(sizeof(Contact));
-        if (newContact == NULL)
+        lineNumber += 1;
+        if (strchr(line, '\n') == NULL && !feof(script))
         {
-            fprintf(stderr, "Error: Memory allocation error, Contact %d in loadContactsFromFile", i);
-            fclose(inputStream);
-            return NULL;
+            /*drop the rest of the line instead of running it as the next command*/
+            tooLong = false;
+            while ((next = getc(script)) != EOF && next != '\n')
+            {
+                tooLong = true;
+            }
+            if (tooLong)
+            {
+                fprintf(stderr, "Error: %s line %d is longer than %d characters\n", scriptName, lineNumber, (int)sizeof(line) - 1);
+                failures += 1;
+                continue;
+            }
         }
-
-        /*firstName*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        myFirstName = (char*)calloc((strlen(scanBuffer) + 1), sizeof(char));
-        if (myFirstName == NULL)
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!runBatchCommand(book, line))
         {
-            fprintf(stderr, "Error: Memory allocation error, memory for string in Contact %d not allocated", i);
-            free(newContact);
-            fclose(inputStream);
-            return NULL;
+            fprintf(stderr, "Error: %s line %d failed\n", scriptName, lineNumber);
+            failures += 1;
         }
-        strcpy(myFirstName, scanBuffer);
-        newContact->firstName = myFirstName;
+    }
+    return failures;
+}
+
+/*
+Non-interactive mode:
+    addressBook [--quiet|-q] [--threads N|auto] [--tombstones] [--script FILE] ["command args" ...]
+Commands run in order, the script (- for stdin) first, then each remaining argument
+as one command line. Output is fully buffered and no menu or prompt is printed.
+*/
+int runBatch(AddressBook* book, int argc, char* argv[])
+{
+    FILE* script = NULL;
+    char* scriptName = NULL;
+    char command[1024] = {"\0"};
+    int failures = 0;
+    int first = 1;
 
-        /*familyName*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        myFamilyName = (char*)calloc((strlen(scanBuffer) + 1), sizeof(char));
-        if (myFamilyName == NULL)
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+
+    for (; first < argc && argv[first][0] == '-'; first++)
+    {
+        if (strcmp(argv[first], "--quiet") == 0 || strcmp(argv[first], "-q") == 0)
         {
-            fprintf(stderr, "Error: Memory allocation error, memory for string in Contact %d not allocated", i);
-            free(myFirstName);
-            free(newContact);
-            fclose(inputStream);
-            return NULL;
+            quietMode = true;
         }
-        strcpy(myFamilyName, scanBuffer);
-        newContact->familyName = myFamilyName;
-
-        /*address*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        myAddress = (char*)calloc((strlen(scanBuffer) + 1), sizeof(char));
-        if (myAddress == NULL)
+        else if (strcmp(argv[first], "--threads") == 0 && first + 1 < argc)
         {
-            fprintf(stderr, "Error: Memory allocation error, memory for string in Contact %d not allocated", i);
-            free(myFirstName);
-            free(myFamilyName);
-            free(newContact);
-            fclose(inputStream);
-            return NULL;
+            if (!setLoadThreads(argv[++first]))
+            {
+                return 2;
+            }
         }
-        strcpy(myAddress, scanBuffer);
-        newContact->address = myAddress;
-
-        /*phoneNumber*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%99[^\n]", scanBuffer);
-        if (!(validPhoneNumber(scanBuffer)))
+        else if (strcmp(argv[first], "--tombstones") == 0)
         {
-            fprintf(stderr, "Error: Invalid phone number.");
-            myPhoneNumber = 0;
+            deferRemovals = true;
+        }
+        else if (strcmp(argv[first], "--script") == 0 && first + 1 < argc)
+        {
+            scriptName = argv[++first];
         }
         else
         {
-            myPhoneNumber = atoll(scanBuffer);
+            fprintf(stderr, "Usage: %s [--quiet] [--threads N|auto] [--tombstones] [--script FILE] [\"command args\" ...]\n", argv[0]);
+            return 2;
         }
-        newContact->phonNum = myPhoneNumber;
+    }
 
-        /*age*/
-        fgets(getBuffer, sizeof(getBuffer), inputStream);
-        sscanf(getBuffer, "%d", &myAge);
-        if (!(myAge >= MIN_AGE && myAge <= MAX_AGE))
+    if (scriptName != NULL)
+    {
+        script = strcmp(scriptName, "-") == 0 ? stdin : fopen(scriptName, "r");
+        if (script == NULL)
         {
-            fprintf(stderr, "Error: Invalid age.");
-            myAge = 0;
+            fprintf(stderr, "Error: could not open script %s\n", scriptName);
+            return 2;
+        }
+        failures += runBatchScript(book, script, scriptName);
+        if (script != stdin)
+        {
+            fclose(script);
         }
-        newContact->age = myAge;
+    }
 
-        /*check to see if this name is already in the book*/
-        if (nameInBook(myFirstName, myFamilyName, contacts))
+    for (; first < argc; first++)
+    {
+        snprintf(command, sizeof(command), "%s", argv[first]);
+        if (!runBatchCommand(book, command))
         {
-            printf("Duplicate Contact detected\n");
-            free(myFirstName);
-            free(myFamilyName);
-            free(myAddress);
-            free(newContact);
-            continue;
+            fprintf(stderr, "Error: command '%s' failed\n", argv[first]);
+            failures += 1;
         }
+    }
+
+    fflush(stdout);
+    return failures == 0 ? 0 : 1;
+}
+
+/*
+xorshift64*, enough randomness for test data and repeatable from a seed.
+*/
+unsigned long long nextRandom(unsigned long long* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+/*
+Picks from 0..range-1 with a cubic skew toward the front of the range, so a few
+names are very common and most are rare, like real name frequencies.
+*/
+int skewedPick(unsigned long long* state, int range)
+{
+    double u = (double)(nextRandom(state) >> 11) / (double)(1ULL << 53);
+    return (int)(range * u * u * u);
+}
+
+void generateContactFields(unsigned long long* state, char* firstName, char* familyName, char* address, char* phone, char* age)
+{
+    static const char* const FIRST_NAMES[] = {"james", "mary", "john", "patricia", "robert", "jennifer", "michael", "linda",
+        "david", "elizabeth", "william", "barbara", "richard", "susan", "joseph", "jessica", "thomas", "sarah", "wei",
+        "li", "priya", "arjun", "fatima", "mohammed", "sofia", "mateo", "yuki", "haruto", "olga", "ivan", "amara", "kofi"};
+    static const char* const SYLLABLES[] = {"sa", "le", "ko", "mi", "ra", "ton", "ber", "chen", "wa", "ng", "son", "li",
+        "da", "vis", "mar", "tin"};
+    static const char* const STREETS[] = {"Main", "Oak", "Maple", "Cedar", "Pine", "Elm", "Kingsway", "Hastings",
+        "Broadway", "Granville"};
+    static const char* const SUFFIXES[] = {"St", "Ave", "Rd", "Blvd", "Way", "Dr"};
+    const int NUM_FIRST = sizeof(FIRST_NAMES) / sizeof(FIRST_NAMES[0]);
+    const int NUM_SYLLABLES = sizeof(SYLLABLES) / sizeof(SYLLABLES[0]);
+    int family = skewedPick(state, NUM_SYLLABLES * NUM_SYLLABLES * NUM_SYLLABLES);
+
+    snprintf(firstName, 100, "%s", FIRST_NAMES[skewedPick(state, NUM_FIRST)]);
+    snprintf(familyName, 100, "%s%s%s", SYLLABLES[family % NUM_SYLLABLES], SYLLABLES[family / NUM_SYLLABLES % NUM_SYLLABLES],
+        SYLLABLES[family / (NUM_SYLLABLES * NUM_SYLLABLES)]);
+    snprintf(address, 100, "%d %s %s", (int)(nextRandom(state) % 9999) + 1, STREETS[nextRandom(state) % 10], SUFFIXES[nextRandom(state) % 6]);
+    snprintf(phone, 100, "%lld", 2000000000LL + (long long)(nextRandom(state) % 8000000000ULL));
+    snprintf(age, 100, "%d", (int)(nextRandom(state) % 99) + 1);
+}
+
+/*
+Writes count synthetic contacts to filename in the saveContactsToFile format.
+*/
+bool generateContactsFile(const char* filename, int count, unsigned long long seed)
+{
+    FILE* outputStream = NULL;
+    unsigned long long state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    char firstName[100], familyName[100], address[100], phone[100], age[100];
 
-        newAddressBook = insertContactAlphabetical(contacts, newContact);
-        contacts = newAddressBook;
+    if (count < 0)
+    {
+        fprintf(stderr, "Error: negative count in generateContactsFile\n");
+        return false;
+    }
+    outputStream = fopen(filename, "w");
+    if (outputStream == NULL)
+    {
+        fprintf(stderr, "Error: could not open %s in generateContactsFile\n", filename);
+        return false;
+    }
+    setvbuf(outputStream, NULL, _IOFBF, 1 << 20);
+    fprintf(outputStream, "%d\n", count);
+    for (int i = 0; i < count; i++)
+    {
+        generateContactFields(&state, firstName, familyName, address, phone, age);
+        fprintf(outputStream, "%s\n%s\n%s\n%s\n%s\n", firstName, familyName, address, phone, age);
+    }
+    countBytesWritten(ftell(outputStream));
+    if (fclose(outputStream) != 0)
+    {
+        fprintf(stderr, "Error: could not write %s in generateContactsFile\n", filename);
+        return false;
     }
-    printf("Appended contacts from %s\n", filename);
-    return contacts;
+    report("Generated %d contacts in %s\n", count, filename);
+    return true;
 }
 
-void printEditMenu()
+double secondsSince(const struct timespec* start)
 {
-    printf("1. Edit First Name\n");
-    printf("2. Edit Last Name\n");
-    printf("3. Edit Address\n");
-    printf("4. Edit Phone Number\n");
-    printf("5. Edit Age\n");
-    printf("6. Cancel\n");
-    printf("Choose an option: ");
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
 }
 
-Contact** editContact(Contact** contacts)
+/*
+One result per line: CSV with a header before the first row, or one JSON object per line.
+*/
+void reportTiming(bool json, const char* operation, int records, int bookSize, double seconds)
 {
-    int numContacts = countContacts(contacts);
-    int index = 0;
-    Contact* selectedContact = NULL;
-    int option = 0;
-    char scanBuffer[100] = {"\0"};
-    char* myFirstName = NULL;
-    char* myFamilyName = NULL;
-    char* myAddress = NULL;
-    long long myPhoneNumber = 0;
-    int myAge = 0;
-    const int MAX_AGE = 150;
-    const int MIN_AGE = 1;
+    static bool headerPrinted = false;
+    double opsPerSecond = seconds > 0 ? records / seconds : 0;
+    double nsPerRecord = records > 0 ? seconds * 1e9 / records : 0;
 
-    if (numContacts == 0)
+    if (json)
     {
-        printf("No contacts available to edit.\n");
-        return contacts;
+        printf("{\"operation\":\"%s\",\"records\":%d,\"book_size\":%d,\"seconds\":%.6f,\"ops_per_sec\":%.1f,\"ns_per_record\":%.1f}\n",
+            operation, records, bookSize, seconds, opsPerSecond, nsPerRecord);
+        return;
+    }
+    if (!headerPrinted)
+    {
+        printf("operation,records,book_size,seconds,ops_per_sec,ns_per_record\n");
+        headerPrinted = true;
     }
+    printf("%s,%d,%d,%.6f,%.1f,%.1f\n", operation, records, bookSize, seconds, opsPerSecond, nsPerRecord);
+}
 
-    printf("Enter index of contact to edit (0-%d): ", numContacts-1);
-    if (scanf("%d", &index) != 1 || !(0 <= index && index <= numContacts-1))
+/*
+Times the core operations on a book loaded from the generated files. Single insert
+and remove are timed over numSingle calls, since each one is linear in the book size.
+*/
+bool timeBenchmarkOperations(AddressBook* book, char* baseFile, char* extraFile, char* saveFile, int count, int numSingle, bool json)
+{
+    Contact* newContact = NULL;
+    char (*names)[2][100] = allocate(sizeof(*names) * (numSingle > 0 ? numSingle : 1));
+    char address[100], phone[100], age[100];
+    unsigned long long state = 0x5EED;
+    struct timespec start;
+    double seconds = 0;
+    int savedStdout = -1;
+    int devNull = -1;
+
+    if (names == NULL)
     {
-        fprintf(stderr, "Error: Invalid Index");
-        return contacts;
+        fprintf(stderr, "Error: Memory allocation failed in timeBenchmarkOperations");
+        return false;
     }
 
-    selectedContact = contacts[index];
-    
-    printf("Editing contact: %s %s\n", selectedContact->firstName, selectedContact->familyName);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!loadContactsFromFile(book, baseFile))
+    {
+        free(names);
+        return false;
+    }
+    reportTiming(json, "loadContactsFromFile", count, book->count, secondsSince(&start));
 
-    printEditMenu();
-    scanf("%d", &option);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!saveContactsToFile(book, saveFile))
+    {
+        free(names);
+        return false;
+    }
+    reportTiming(json, "saveContactsToFile", book->count, book->count, secondsSince(&start));
 
-    switch(option)
+    /*list output goes to /dev/null so the terminal is not what gets measured*/
+    fflush(stdout);
+    savedStdout = dup(STDOUT_FILENO);
+    devNull = open("/dev/null", O_WRONLY);
+    if (savedStdout >= 0 && devNull >= 0 && dup2(devNull, STDOUT_FILENO) >= 0)
     {
-        case EDIT_FIRST:
-            printf("Enter new first name: ");
-            scanf("%s", scanBuffer);
-            selectedContact->firstName = (char*)realloc(selectedContact->firstName, (strlen(scanBuffer) + 1) * sizeof(char));
-            if (selectedContact == NULL)
-            {
-                fprintf(stderr, "Error: Memory allocation error for string in editContact");
-                return NULL;
-            }
-            strcpy(selectedContact->firstName, scanBuffer);
-            break;
-        case EDIT_LAST:
-            printf("Enter new family name: ");
-            scanf("%s", scanBuffer);
-            selectedContact->familyName = (char*)realloc(selectedContact->familyName, (strlen(scanBuffer) + 1) * sizeof(char));
-            if (selectedContact == NULL)
-            {
-                fprintf(stderr, "Error: Memory allocation error for string in editContact");
-                return NULL;
-            }
-            strcpy(selectedContact->familyName, scanBuffer);
-            break;
-        case EDIT_ADDR:
-            printf("Enter new address: ");
-            fscanf(stdin, " %99[^\n]", scanBuffer);
-            selectedContact->address = (char*)realloc(selectedContact->address, (strlen(scanBuffer) + 1) * sizeof(char));
-            if (selectedContact == NULL)
-            {
-                fprintf(stderr, "Error: Memory allocation error for string in editContact");
-                return NULL;
-            }
-            strcpy(selectedContact->address, scanBuffer);
-            break;
-        case EDIT_PHN:
-            printf("Enter new phone number: Enter 10-digit phone number that must not start with 0: ");
-            fscanf(stdin, " %99[^\n]", scanBuffer);
-            if (!(validPhoneNumber(scanBuffer)))
-            {
-                fprintf(stderr, "Error: Invalid phone number.\n");
-                return contacts;
-            }
-            else
-            {
-                myPhoneNumber = atoll(scanBuffer);
-            }
-            selectedContact->phonNum = myPhoneNumber;
-            break;
-        case EDIT_AGE:
-            printf("Enter new age: ");
-            fscanf(stdin, "%d", &myAge);
-            if (!(myAge >= MIN_AGE && myAge <= MAX_AGE))
-            {
-                fprintf(stderr, "Error: Invalid age.");
-                return contacts;
-            }
-            selectedContact->age = myAge;
-            break;
-        case CANCEL:
-            printf("Edit cancelled.\n");
-            return contacts;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        listContacts(book);
+        fflush(stdout);
+        seconds = secondsSince(&start);
+        dup2(savedStdout, STDOUT_FILENO);
+        reportTiming(json, "listContacts", book->count, book->count, seconds);
     }
-    printf("Contact updated successfully.\n");
-    return contacts;
+    if (savedStdout >= 0)
+    {
+        close(savedStdout);
+    }
+    if (devNull >= 0)
+    {
+        close(devNull);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!appendContactsFromFile(book, extraFile))
+    {
+        free(names);
+        return false;
+    }
+    reportTiming(json, "appendContactsFromFile", count / 2, book->count, secondsSince(&start));
+
+    if (!loadContactsFromFile(book, baseFile))
+    {
+        free(names);
+        return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!mergeContactsFromFile(book, extraFile))
+    {
+        free(names);
+        return false;
+    }
+    reportTiming(json, "mergeContactsFromFile", count / 2, book->count, secondsSince(&start));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < numSingle; i++)
+    {
+        generateContactFields(&state, names[i][0], names[i][1], address, phone, age);
+        /*a numbered first name keeps the full name unique so every remove below finds it*/
+        snprintf(names[i][0], 100, "bench%d", i);
+        newContact = newContactFromFields(names[i][0], names[i][1], address, phone, age);
+        if (newContact == NULL || !insertContactAlphabetical(book, newContact))
+        {
+            freeContact(newContact);
+            free(names);
+            return false;
+        }
+    }
+    reportTiming(json, "insertContactAlphabetical", numSingle, book->count, secondsSince(&start));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < numSingle; i++)
+    {
+        if (!removeContactNamed(book, names[i][0], names[i][1]))
+        {
+            free(names);
+            return false;
+        }
+    }
+    reportTiming(json, "removeContactByFullName", numSingle, book->count, secondsSince(&start));
+
+    free(names);
+    return true;
+}
+
+/*
+Benchmarks a generated book of count contacts. The data files are written to a fresh
+directory under $TMPDIR (or /tmp), so no file of the user's is touched, and removed
+with it afterwards.
+*/
+bool runBenchmark(int count, bool json)
+{
+    const char* temporaryRoot = getenv("TMPDIR");
+    char directory[1024] = {"\0"};
+    char baseFile[1100] = {"\0"};
+    char extraFile[1100] = {"\0"};
+    char saveFile[1100] = {"\0"};
+    const int SINGLE_OPS = count <= 100000 ? 1000 : 100;
+    bool wasQuiet = quietMode;
+    bool ok = false;
+    AddressBook* book = NULL;
+
+    if (count <= 0)
+    {
+        fprintf(stderr, "Error: benchmark needs a positive count\n");
+        return false;
+    }
+    if (temporaryRoot == NULL || temporaryRoot[0] == '\0')
+    {
+        temporaryRoot = "/tmp";
+    }
+    if (snprintf(directory, sizeof(directory), "%s/addressBook-benchmark-XXXXXX", temporaryRoot) >= (int)sizeof(directory)
+        || mkdtemp(directory) == NULL)
+    {
+        fprintf(stderr, "Error: could not create a directory for the benchmark files\n");
+        return false;
+    }
+    snprintf(baseFile, sizeof(baseFile), "%s/base.txt", directory);
+    snprintf(extraFile, sizeof(extraFile), "%s/extra.txt", directory);
+    snprintf(saveFile, sizeof(saveFile), "%s/save.txt", directory);
+    book = createAddressBook();
+    if (book == NULL)
+    {
+        fprintf(stderr, "Error: Memory allocation failed in runBenchmark");
+        rmdir(directory);
+        return false;
+    }
+
+    quietMode = true;
+    ok = generateContactsFile(baseFile, count, 1) && generateContactsFile(extraFile, count / 2, 2)
+        && timeBenchmarkOperations(book, baseFile, extraFile, saveFile, count, count < SINGLE_OPS ? count : SINGLE_OPS, json);
+    quietMode = wasQuiet;
+
+    remove(baseFile);
+    remove(extraFile);
+    remove(saveFile);
+    rmdir(directory);
+    freeAddressBook(book);
+    if (!ok)
+    {
+        fprintf(stderr, "Error: benchmark of %d contacts did not complete\n", count);
+    }
+    return ok;
+}
+
+void* allocate(size_t size)
+{
+    statistics.heapAllocations += 1;
+    return malloc(size);
 }
 
+void* allocateZeroed(size_t count, size_t size)
+{
+    statistics.heapAllocations += 1;
+    return calloc(count, size);
+}
+
+void* reallocate(void* pointer, size_t size)
+{
+    statistics.heapAllocations += 1;
+    return realloc(pointer, size);
+}
+
+void countBytesWritten(long long written)
+{
+    if (written > 0)
+    {
+        statistics.bytesWritten += written;
+    }
+}
+
+unsigned long long statStart()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/*
+Adds the time since start to the operation's histogram. Values below 4ns get their
+own bucket; above that the bucket is the position of the top bit plus the two bits
+after it.
+*/
+void statStop(int operation, unsigned long long start)
+{
+    OperationStats* stats = &statistics.operations[operation];
+    unsigned long long elapsed = statStart() - start;
+    int topBit = 2;
+    int bucket = (int)elapsed;
 
+    if (elapsed >= 4)
+    {
+        while ((elapsed >> topBit) > 1)
+        {
+            topBit++;
+        }
+        bucket = (topBit - 1) * 4 + (int)((elapsed >> (topBit - 2)) & 3);
+    }
+    stats->calls += 1;
+    stats->totalNs += elapsed;
+    if (elapsed > stats->maxNs)
+    {
+        stats->maxNs = elapsed;
+    }
+    stats->buckets[bucket] += 1;
+}
 
+/*
+Largest value that lands in bucket.
+*/
+unsigned long long statBucketLimit(int bucket)
+{
+    int topBit = bucket / 4 + 1;
 
+    if (bucket < 4)
+    {
+        return bucket;
+    }
+    return ((4ULL + bucket % 4 + 1) << (topBit - 2)) - 1;
+}
 
+unsigned long long statPercentile(const OperationStats* operation, double fraction)
+{
+    unsigned long long target = (unsigned long long)(fraction * operation->calls + 0.5);
+    unsigned long long seen = 0;
 
+    if (target == 0)
+    {
+        target = 1;
+    }
+    for (int i = 0; i < STAT_BUCKETS; i++)
+    {
+        seen += operation->buckets[i];
+        if (seen >= target)
+        {
+            return statBucketLimit(i) < operation->maxNs ? statBucketLimit(i) : operation->maxNs;
+        }
+    }
+    return operation->maxNs;
+}
 
+void printStatistics(FILE* outputStream)
+{
+    static const char* const NAMES[NUM_STAT_OPERATIONS] = {"appendContact", "insertContactAlphabetical", "nameInBook",
+        "  parse record", "  shift contacts", "loadContactsFromFile", "loadContactsMapped", "loadContactsLazy", "loadSnapshot",
+        "appendContactsFromFile", "mergeContactsFromFile", "mergeContactFiles", "saveContactsToFile", "printContactsToFile", "saveSnapshot"};
+    const OperationStats* operation = NULL;
 
+    fprintf(outputStream, "%-26s %12s %14s %12s %12s %12s\n", "Operation", "Calls", "Total ms", "p50 ns", "p99 ns", "Max ns");
+    for (int i = 0; i < NUM_STAT_OPERATIONS; i++)
+    {
+        operation = &statistics.operations[i];
+        if (operation->calls == 0)
+        {
+            continue;
+        }
+        fprintf(outputStream, "%-26s %12llu %14.3f %12llu %12llu %12llu\n", NAMES[i], operation->calls, operation->totalNs / 1e6,
+            statPercentile(operation, 0.50), statPercentile(operation, 0.99), operation->maxNs);
+    }
+    fprintf(outputStream, "Heap allocations: %llu\n", statistics.heapAllocations);
+    fprintf(outputStream, "Arena allocations: %llu\n", statistics.arenaAllocations);
+    fprintf(outputStream, "String comparisons: %llu\n", statistics.stringComparisons);
+    fprintf(outputStream, "Bytes read: %llu\n", statistics.bytesRead);
+    fprintf(outputStream, "Bytes written: %llu\n", statistics.bytesWritten);
+}
 
+void resetStatistics()
+{
+    memset(&statistics, 0, sizeof(statistics));
+}